@@ -0,0 +1,425 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "analyzer.h"
+
+// The maximum number of instructions followed when looking for the next use of the index register.
+#define INDEX_LOOKAHEAD_LIMIT 32
+
+// The maximum number of entries followed in a jump table targeted by an 0xBNNN instruction.
+#define JUMP_TABLE_LIMIT 16
+
+// Describes how an instruction interacts with the index register.
+typedef enum
+{
+	INDEX_USE_NONE,
+	INDEX_USE_TRAVERSE,
+	INDEX_USE_ADVANCE,
+	INDEX_USE_REDEFINE
+} IndexUse;
+
+static void MarkAddress(uint8_t *map, const uint16_t address)
+{
+	map[address >> 3] |= 1 << (address & 7);
+}
+
+static bool IsAddressMarked(const uint8_t *map, const uint16_t address)
+{
+	return map[address >> 3] & 1 << (address & 7);
+}
+
+// The program being analysed, as it would be laid out in the heap from PROGRAM_OFFSET.
+typedef struct
+{
+	const uint8_t *bytes;
+	size_t size;
+} Program;
+
+// Fetches the instruction at the specified address, which must lie within the program.
+static uint16_t FetchInstruction(const Program *program, const uint16_t address)
+{
+	return program->bytes[address - PROGRAM_OFFSET] << 8 | program->bytes[address - PROGRAM_OFFSET + 1];
+}
+
+// Returns true if a whole instruction at the specified address lies within the program.
+// Only the first 4KiB of the heap is analysed, as the CHIP-8 address space cannot reach beyond it without XO-CHIP's 0xF000 NNNN.
+static bool IsInProgram(const Program *program, const uint16_t address)
+{
+	const size_t end = (size_t)address + INSTRUCTION_WIDTH;
+	return address >= PROGRAM_OFFSET && end <= PROGRAM_OFFSET + program->size && end <= CHIP_8_HEAP_SIZE;
+}
+
+static bool IsSkipInstruction(const uint16_t inst)
+{
+	switch (inst >> 12)
+	{
+		case 0x3:
+		case 0x4:
+			return true;
+		case 0x5:
+		case 0x9:
+			return (inst & 0x000F) == 0;
+		case 0xE:
+			return (inst & 0x00FF) == 0x9E || (inst & 0x00FF) == 0xA1;
+		default:
+			return false;
+	}
+}
+
+static bool IsSuperChipInstruction(const uint16_t inst)
+{
+	if ((inst & 0xFFF0) == 0x00C0 && (inst & 0x000F) != 0)
+		return true;
+
+	switch (inst)
+	{
+		case 0x00FB:
+		case 0x00FC:
+		case 0x00FD:
+		case 0x00FE:
+		case 0x00FF:
+			return true;
+		default:
+			break;
+	}
+
+	if ((inst & 0xF000) == 0xF000)
+	{
+		const uint8_t nn = inst & 0x00FF;
+		return nn == 0x30 || nn == 0x75 || nn == 0x85;
+	}
+
+	return false;
+}
+
+static bool IsXoChipInstruction(const uint16_t inst)
+{
+	if ((inst & 0xFFF0) == 0x00D0 && (inst & 0x000F) != 0)
+		return true;
+
+	if ((inst & 0xF000) == 0x5000)
+		return (inst & 0x000F) == 0x2 || (inst & 0x000F) == 0x3;
+
+	if (inst == 0xF000 || inst == 0xF002)
+		return true;
+
+	if ((inst & 0xF000) == 0xF000)
+	{
+		const uint8_t nn = inst & 0x00FF;
+		return nn == 0x01 || nn == 0x3A;
+	}
+
+	return false;
+}
+
+static IndexUse ClassifyIndexUse(const uint16_t inst)
+{
+	if ((inst & 0xF000) == 0xA000)
+		return INDEX_USE_REDEFINE;
+
+	if ((inst & 0xF000) != 0xF000)
+		return INDEX_USE_NONE;
+
+	switch (inst & 0x00FF)
+	{
+		case 0x1E:
+			return INDEX_USE_ADVANCE;
+		case 0x29:
+		case 0x30:
+			return INDEX_USE_REDEFINE;
+		case 0x33:
+		case 0x55:
+		case 0x65:
+			return INDEX_USE_TRAVERSE;
+		default:
+			return INDEX_USE_NONE;
+	}
+}
+
+// Follows the straight-line path after an 0xFX55/0xFX65 instruction to find the next instruction that uses the index register.
+// Traversing memory again without redefining the index register relies on the COSMAC VIP behaviour of incrementing it,
+// whereas advancing it explicitly with 0xFX1E relies on the index register being left unchanged.
+static void AnalyzeIndexUsage(const Program *program, uint16_t address, C8_Analysis *analysis)
+{
+	for (int step = 0; step < INDEX_LOOKAHEAD_LIMIT && IsInProgram(program, address); ++step)
+	{
+		const uint16_t inst = FetchInstruction(program, address);
+
+		switch (ClassifyIndexUse(inst))
+		{
+			case INDEX_USE_TRAVERSE:
+				++analysis->temporaryIndex.disabled;
+				return;
+			case INDEX_USE_ADVANCE:
+				++analysis->temporaryIndex.enabled;
+				return;
+			case INDEX_USE_REDEFINE:
+				return;
+			default:
+				break;
+		}
+
+		switch (inst >> 12)
+		{
+			case 0x0:
+				if (inst == 0x00EE || inst == 0x00FD)
+					return;
+				address += INSTRUCTION_WIDTH;
+				break;
+			case 0x1:
+				address = inst & 0x0FFF;
+				break;
+			case 0x2:
+			case 0xB:
+				return;
+			default:
+				address += INSTRUCTION_WIDTH;
+				break;
+		}
+	}
+}
+
+// Shifting with distinct V(x) and V(y) registers is only meaningful if V(y) is the source of the shift,
+// whereas CHIP-48 era programs commonly encode an in-place shift as 0x8X06/0x8X0E.
+static void AnalyzeShift(const uint8_t x, const uint8_t y, C8_Analysis *analysis)
+{
+	if (x == y)
+		return;
+
+	if (y == 0)
+		++analysis->parameterisedShift.enabled;
+	else
+		++analysis->parameterisedShift.disabled;
+}
+
+void C8_AnalyzeProgramBytes(const uint8_t *bytes, const size_t size, const C8_Config config, C8_Analysis *analysis)
+{
+	*analysis = (C8_Analysis){
+		.config = config
+	};
+
+	const Program *program = &(Program){ bytes, size };
+
+	uint8_t visited[CHIP_8_HEAP_SIZE / 8] = { 0 };
+	uint16_t worklist[CHIP_8_HEAP_SIZE];
+	uint16_t worklistCount = 0;
+
+	// Registers written anywhere in the reachable code, and registers used as an offset by 0xBXNN.
+	uint16_t registersWritten = 0;
+	uint16_t jumpOffsetRegisters = 0;
+
+	worklist[worklistCount++] = PROGRAM_OFFSET;
+
+	while (worklistCount > 0)
+	{
+		uint16_t address = worklist[--worklistCount];
+
+		while (IsInProgram(program, address) && !IsAddressMarked(visited, address))
+		{
+			MarkAddress(visited, address);
+			MarkAddress(analysis->codeMap, address);
+			MarkAddress(analysis->codeMap, address + 1);
+			++analysis->instructionCount;
+
+			const uint16_t inst = FetchInstruction(program, address);
+			const uint8_t x = (inst & 0x0F00) >> 8;
+			const uint8_t y = (inst & 0x00F0) >> 4;
+			const uint8_t n = inst & 0x000F;
+			const uint16_t nnn = inst & 0x0FFF;
+
+			if (IsSuperChipInstruction(inst))
+				analysis->usesSuperChipInstructions = true;
+
+			if (IsXoChipInstruction(inst))
+				analysis->usesXoChipInstructions = true;
+
+			// 0xF000 NNNN is followed by a 16-bit address rather than an instruction.
+			if (inst == 0xF000 && IsInProgram(program, address + INSTRUCTION_WIDTH))
+			{
+				MarkAddress(analysis->codeMap, address + 2);
+				MarkAddress(analysis->codeMap, address + 3);
+				address += INSTRUCTION_WIDTH;
+			}
+
+			// Skipping over XO-CHIP's 0xF000 NNNN skips all 4 bytes of it.
+			if (IsSkipInstruction(inst) && worklistCount < CHIP_8_HEAP_SIZE)
+			{
+				const bool isLongInstructionNext = IsInProgram(program, address + INSTRUCTION_WIDTH)
+					&& FetchInstruction(program, address + INSTRUCTION_WIDTH) == 0xF000;
+				worklist[worklistCount++] = address + (isLongInstructionNext ? 3 : 2) * INSTRUCTION_WIDTH;
+			}
+
+			address += INSTRUCTION_WIDTH;
+
+			switch (inst >> 12)
+			{
+				case 0x0:
+					// Returns and exits end the current path.
+					if (inst == 0x00EE || inst == 0x00FD)
+						address = 0;
+					break;
+				case 0x1:
+					address = nnn;
+					break;
+				case 0x2:
+					if (worklistCount < CHIP_8_HEAP_SIZE)
+						worklist[worklistCount++] = nnn;
+					break;
+				case 0x6:
+				case 0x7:
+				case 0xC:
+					registersWritten |= 1 << x;
+					break;
+				case 0x8:
+					registersWritten |= 1 << x;
+					if (n >= 0x4)
+						registersWritten |= 1 << 0xF;
+					if (n == 0x6 || n == 0xE)
+						AnalyzeShift(x, y, analysis);
+					break;
+				case 0xA:
+					if (nnn < CHIP_8_HEAP_SIZE)
+						MarkAddress(analysis->dataMap, nnn);
+					break;
+				case 0xB:
+				{
+					analysis->hasIndirectJumps = true;
+					if (x != 0)
+						jumpOffsetRegisters |= 1 << x;
+
+					// Jump tables are typically a sequence of 0x1NNN instructions starting at (nnn).
+					for (uint16_t entry = nnn, i = 0; i < JUMP_TABLE_LIMIT && IsInProgram(program, entry); ++i, entry += INSTRUCTION_WIDTH)
+					{
+						if (FetchInstruction(program, entry) >> 12 != 0x1 || worklistCount >= CHIP_8_HEAP_SIZE)
+							break;
+						worklist[worklistCount++] = entry;
+					}
+
+					address = 0;
+					break;
+				}
+				case 0xD:
+					registersWritten |= 1 << 0xF;
+					break;
+				case 0xF:
+				{
+					switch (inst & 0x00FF)
+					{
+						case 0x07:
+						case 0x0A:
+							registersWritten |= 1 << x;
+							break;
+						case 0x65:
+							registersWritten |= (2 << x) - 1;
+							AnalyzeIndexUsage(program, address, analysis);
+							break;
+						case 0x55:
+							AnalyzeIndexUsage(program, address, analysis);
+							break;
+						default:
+							break;
+					}
+					break;
+				}
+				default:
+					break;
+			}
+		}
+	}
+
+	// 0xBXNN only differs from 0xBNNN when X is non-zero; whichever of V0 and V(x) the program actually sets is the likely offset.
+	for (uint8_t x = 1; x < 16; ++x)
+	{
+		if (!(jumpOffsetRegisters & 1 << x))
+			continue;
+
+		const bool isOffsetWritten = registersWritten & 1 << x;
+		const bool isV0Written = registersWritten & 1;
+		if (isOffsetWritten && !isV0Written)
+			++analysis->parameterisedJump.enabled;
+		else if (isV0Written && !isOffsetWritten)
+			++analysis->parameterisedJump.disabled;
+	}
+
+	// Programs using SUPER-CHIP instructions were written for interpreters with all quirks enabled, whereas XO-CHIP
+	// follows Octo, which increments the index register on 0xFX55/0xFX65, shifts V(y) and jumps to NNN + V0.
+	// Programs too large for the 4KiB heap can only be run by XO-CHIP interpreters.
+	if (analysis->usesXoChipInstructions || size > CHIP_8_HEAP_SIZE - PROGRAM_OFFSET)
+	{
+		analysis->config.platform = C8_PLATFORM_XO_CHIP;
+		++analysis->parameterisedShift.disabled;
+		++analysis->parameterisedJump.disabled;
+		++analysis->temporaryIndex.disabled;
+	}
+	else if (analysis->usesSuperChipInstructions)
+	{
+		analysis->config.platform = C8_PLATFORM_SUPER_CHIP;
+		++analysis->parameterisedShift.enabled;
+		++analysis->parameterisedJump.enabled;
+		++analysis->temporaryIndex.enabled;
+	}
+
+	if (analysis->parameterisedShift.enabled != analysis->parameterisedShift.disabled)
+		analysis->config.useParameterisedShift = analysis->parameterisedShift.enabled > analysis->parameterisedShift.disabled;
+
+	if (analysis->parameterisedJump.enabled != analysis->parameterisedJump.disabled)
+		analysis->config.useParameterisedJump = analysis->parameterisedJump.enabled > analysis->parameterisedJump.disabled;
+
+	if (analysis->temporaryIndex.enabled != analysis->temporaryIndex.disabled)
+		analysis->config.useTemporaryIndex = analysis->temporaryIndex.enabled > analysis->temporaryIndex.disabled;
+}
+
+void C8_AnalyzeProgram(const C8_Instance *instance, C8_Analysis *analysis)
+{
+	// Only the first 4KiB of the heap is analysed, so only that much of the program needs copying out of it.
+	uint8_t bytes[CHIP_8_HEAP_SIZE - PROGRAM_OFFSET];
+	const size_t size = instance->programSize;
+	for (size_t i = 0; i < size && i < sizeof(bytes); ++i)
+		bytes[i] = C8_ReadHeap(instance, PROGRAM_OFFSET + i);
+
+	C8_AnalyzeProgramBytes(bytes, size, instance->config, analysis);
+}
+
+bool C8_LoadProgramDetected(C8_Instance *instance, const uint8_t *program, const size_t size, C8_Analysis *analysis, char **error)
+{
+	C8_AnalyzeProgramBytes(program, size, instance->config, analysis);
+
+	// Memory is sized for the platform when loading, so the program is loaded only once the platform is known.
+	// The suggested configuration starts from the instance's, so settings the analyzer doesn't infer are kept.
+	const C8_Config previousConfig = instance->config;
+	instance->config = analysis->config;
+
+	if (!C8_LoadProgramFromMemory(instance, program, size, error))
+	{
+		instance->config = previousConfig;
+		return false;
+	}
+
+	return true;
+}
+
+bool C8_LoadProgramFileDetected(C8_Instance *instance, const char *filePath, C8_Analysis *analysis, char **error)
+{
+	uint8_t *program = malloc(C8_MAX_PROGRAM_SIZE);
+	if (!program)
+	{
+		*error = "Failed to allocate memory.";
+		return false;
+	}
+
+	size_t size;
+	const bool isLoaded = C8_ReadProgram(filePath, program, &size, error) && C8_LoadProgramDetected(instance, program, size, analysis, error);
+	free(program);
+
+	return isLoaded;
+}
+
+bool C8_IsQuirkSettled(const C8_QuirkEvidence evidence)
+{
+	return (evidence.enabled > 0) != (evidence.disabled > 0);
+}
+
+bool C8_IsCode(const C8_Analysis *analysis, const uint16_t address)
+{
+	return address < CHIP_8_HEAP_SIZE && IsAddressMarked(analysis->codeMap, address);
+}
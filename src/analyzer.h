@@ -0,0 +1,79 @@
+#ifndef C8_ANALYZER_H
+#define C8_ANALYZER_H
+
+#include <stdint.h>
+
+#include "vm.h"
+
+// Counts the code patterns found in a program that suggest a quirk should be enabled or disabled.
+typedef struct
+{
+	// The number of patterns suggesting the quirk should be enabled (CHIP-48, SUPER-CHIP behaviour).
+	uint16_t enabled;
+
+	// The number of patterns suggesting the quirk should be disabled (COSMAC VIP, XO-CHIP behaviour).
+	uint16_t disabled;
+} C8_QuirkEvidence;
+
+// The result of statically analysing a loaded CHIP-8 program.
+typedef struct
+{
+	// The suggested configuration.
+	// Quirks without conclusive evidence retain the value they had in the analysed configuration.
+	// The SUPER-CHIP or XO-CHIP platform is suggested if the program uses any of their instructions,
+	// and XO-CHIP if the program is too large for the 4KiB heap.
+	C8_Config config;
+
+	// Evidence for the 0x8XY6/0x8XYE 'use parameterised shift' quirk.
+	C8_QuirkEvidence parameterisedShift;
+
+	// Evidence for the 0xBNNN 'use parameterised jump' quirk.
+	C8_QuirkEvidence parameterisedJump;
+
+	// Evidence for the 0xFX55/0xFX65 'use temporary index' quirk.
+	C8_QuirkEvidence temporaryIndex;
+
+	// The number of instructions reachable from PROGRAM_OFFSET.
+	uint16_t instructionCount;
+
+	// True if the program contains 0xBNNN jumps, whose targets cannot be fully determined statically.
+	bool hasIndirectJumps;
+
+	// True if the program contains instructions only supported by SUPER-CHIP interpreters.
+	bool usesSuperChipInstructions;
+
+	// True if the program contains instructions only supported by XO-CHIP interpreters.
+	bool usesXoChipInstructions;
+
+	// One bit per heap address, set if the byte belongs to a reachable instruction.
+	uint8_t codeMap[CHIP_8_HEAP_SIZE / 8];
+
+	// One bit per heap address, set if the byte is the target of an 0xANNN instruction.
+	uint8_t dataMap[CHIP_8_HEAP_SIZE / 8];
+} C8_Analysis;
+
+// Builds a control-flow graph of the program loaded into the provided virtual machine,
+// starting at PROGRAM_OFFSET, and infers which quirks the program expects from its code patterns.
+void C8_AnalyzeProgram(const C8_Instance *instance, C8_Analysis *analysis);
+
+// Analyses a program that hasn't been loaded yet, such as one read with C8_ReadProgram,
+// starting from the provided configuration.
+void C8_AnalyzeProgramBytes(const uint8_t *program, size_t size, C8_Config config, C8_Analysis *analysis);
+
+// Analyses a program, then loads it into the instance with the suggested platform and quirks.
+// Analysing before loading means programs too large for the configured platform's heap can still be loaded.
+// If this function returns false, the instance's configuration is left unchanged,
+// and error will be populated with a string describing the reason.
+bool C8_LoadProgramDetected(C8_Instance *instance, const uint8_t *program, size_t size, C8_Analysis *analysis, char **error);
+
+// Reads a program from a file, then loads it as C8_LoadProgramDetected does.
+// If this function returns false, error will be populated with a string describing the reason.
+bool C8_LoadProgramFileDetected(C8_Instance *instance, const char *filePath, C8_Analysis *analysis, char **error);
+
+// Returns true if all evidence found for a quirk agrees; otherwise, false.
+bool C8_IsQuirkSettled(C8_QuirkEvidence evidence);
+
+// Returns true if the byte at the specified address was classified as code; otherwise, false.
+bool C8_IsCode(const C8_Analysis *analysis, uint16_t address);
+
+#endif // C8_ANALYZER_H
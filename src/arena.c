@@ -1,35 +1,251 @@
 #include <stdlib.h>
 
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
 #include "arena.h"
 
+// The size of a huge page on common x86-64 and AArch64 configurations.
+#define HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+struct ArenaBlock
+{
+    ArenaBlock *next;
+    size_t size;
+    size_t offset;
+    alignas(max_align_t) unsigned char memory[];
+};
+
+// Returns the offset of the first address at or after [memory] + [offset] that is a multiple of [alignment].
+static size_t AlignOffset(const unsigned char *memory, const size_t offset, const size_t alignment)
+{
+    const uintptr_t address = (uintptr_t)memory + offset;
+    return offset + ((alignment - address % alignment) % alignment);
+}
+
 Arena CreateArena(const size_t size)
 {
     unsigned char *memory = malloc(size);
     return (Arena){
-        .size = size,
+        .size = memory ? size : 0,
         .memory = memory,
         .offset = 0
     };
 }
 
-void *RequestAllocationFromArena(Arena *arena, const size_t size)
+// Maps at least [*size] bytes of zeroed memory from the operating system, rounding [*size] up to the mapping's real size.
+// Returns the mapped memory, or a null pointer if pages can't be mapped on this platform.
+static unsigned char *MapPages(size_t *size, const bool useHugePages)
 {
-    const size_t newOffset = arena->offset + size;
-    if (newOffset > arena->size)
+#if defined(_WIN32)
+    unsigned char *memory = VirtualAlloc(nullptr, *size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    (void)useHugePages;
+    return memory;
+#elif defined(__unix__) || defined(__APPLE__)
+    if (useHugePages)
+    {
+        const size_t hugeSize = (*size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+#ifdef MAP_HUGETLB
+        // Explicit huge pages must be reserved by the system administrator, so this commonly fails.
+        void *memory = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED)
+        {
+            *size = hugeSize;
+            return memory;
+        }
+#endif
+        *size = hugeSize;
+    }
+
+    void *memory = mmap(nullptr, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
         return nullptr;
-    void *allocation = arena->memory + arena->offset;
-    arena->offset = newOffset;
+
+#ifdef MADV_HUGEPAGE
+    // Otherwise, ask for the mapping to be backed by transparent huge pages.
+    if (useHugePages)
+        madvise(memory, *size, MADV_HUGEPAGE);
+#endif
+    return memory;
+#else
+    (void)size;
+    (void)useHugePages;
+    return nullptr;
+#endif
+}
+
+static void UnmapPages(unsigned char *memory, const size_t size)
+{
+#if defined(_WIN32)
+    (void)size;
+    VirtualFree(memory, 0, MEM_RELEASE);
+#elif defined(__unix__) || defined(__APPLE__)
+    munmap(memory, size);
+#else
+    (void)memory;
+    (void)size;
+#endif
+}
+
+Arena CreatePageArena(size_t size, const bool useHugePages)
+{
+    unsigned char *memory = MapPages(&size, useHugePages);
+    if (!memory)
+    {
+        Arena arena = CreateArena(size);
+        arena.useHugePages = useHugePages;
+        return arena;
+    }
+
+    return (Arena){
+        .size = size,
+        .memory = memory,
+        .offset = 0,
+        .isPageMapped = true,
+        .useHugePages = useHugePages
+    };
+}
+
+static void FreeMemory(Arena *arena)
+{
+    if (arena->isPageMapped)
+        UnmapPages(arena->memory, arena->size);
+    else
+        free(arena->memory);
+}
+
+static void FreeOverflowBlocks(Arena *arena, const ArenaBlock *until)
+{
+    while (arena->overflowBlocks != until)
+    {
+        ArenaBlock *next = arena->overflowBlocks->next;
+        free(arena->overflowBlocks);
+        arena->overflowBlocks = next;
+    }
+}
+
+// Serves a request that doesn't fit in the arena's pre-allocated memory from its most recent overflow block,
+// chaining on a new block at least twice the size of the last if that doesn't fit either.
+static void *RequestAllocationFromOverflowBlocks(Arena *arena, const size_t size, const size_t alignment)
+{
+    ArenaBlock *block = arena->overflowBlocks;
+    if (block)
+    {
+        const size_t offset = AlignOffset(block->memory, block->offset, alignment);
+        if (offset + size <= block->size)
+        {
+            arena->used += offset + size - block->offset;
+            block->offset = offset + size;
+            return block->memory + offset;
+        }
+    }
+
+    const size_t previousSize = block ? block->size : arena->size;
+    const size_t blockSize = previousSize * 2 > size + alignment ? previousSize * 2 : size + alignment;
+
+    ArenaBlock *newBlock = malloc(sizeof(ArenaBlock) + blockSize);
+    if (!newBlock)
+        return nullptr;
+
+    newBlock->next = arena->overflowBlocks;
+    newBlock->size = blockSize;
+    newBlock->offset = 0;
+    arena->overflowBlocks = newBlock;
+    ++arena->overflowCount;
+
+    const size_t offset = AlignOffset(newBlock->memory, 0, alignment);
+    newBlock->offset = offset + size;
+    arena->used += offset + size;
+    return newBlock->memory + offset;
+}
+
+void *RequestAlignedAllocationFromArena(Arena *arena, const size_t size, const size_t alignment)
+{
+    void *allocation;
+
+    // Once the arena has overflowed, later requests go to the overflow blocks so allocations stay in order for RestoreArena.
+    const size_t offset = AlignOffset(arena->memory, arena->offset, alignment);
+    if (!arena->overflowBlocks && arena->memory && offset + size <= arena->size)
+    {
+        allocation = arena->memory + offset;
+        arena->used += offset + size - arena->offset;
+        arena->offset = offset + size;
+    }
+    else
+    {
+        allocation = RequestAllocationFromOverflowBlocks(arena, size, alignment);
+    }
+
+    if (arena->used > arena->highWaterMark)
+        arena->highWaterMark = arena->used;
+
     return allocation;
 }
 
+void *RequestAllocationFromArena(Arena *arena, const size_t size)
+{
+    return RequestAlignedAllocationFromArena(arena, size, ARENA_DEFAULT_ALIGNMENT);
+}
+
+ArenaMarker SaveArena(const Arena *arena)
+{
+    return (ArenaMarker){
+        .offset = arena->offset,
+        .overflowBlocks = arena->overflowBlocks,
+        .overflowOffset = arena->overflowBlocks ? arena->overflowBlocks->offset : 0,
+        .used = arena->used
+    };
+}
+
+void RestoreArena(Arena *arena, const ArenaMarker marker)
+{
+    FreeOverflowBlocks(arena, marker.overflowBlocks);
+    if (arena->overflowBlocks)
+        arena->overflowBlocks->offset = marker.overflowOffset;
+
+    arena->offset = marker.offset;
+    arena->used = marker.used;
+}
+
 void ResetArena(Arena *arena)
 {
+    FreeOverflowBlocks(arena, nullptr);
+
+    // Grow to fit the most the arena has ever needed, padded for alignment, so the next cycle doesn't need any overflow blocks.
+    if (arena->highWaterMark > arena->size)
+    {
+        size_t size = arena->highWaterMark + ARENA_DEFAULT_ALIGNMENT;
+        if (arena->isPageMapped)
+        {
+            unsigned char *memory = MapPages(&size, arena->useHugePages);
+            if (memory)
+            {
+                UnmapPages(arena->memory, arena->size);
+                arena->memory = memory;
+                arena->size = size;
+            }
+        }
+        else
+        {
+            unsigned char *memory = realloc(arena->memory, size);
+            if (memory)
+            {
+                arena->memory = memory;
+                arena->size = size;
+            }
+        }
+    }
+
     arena->offset = 0;
+    arena->used = 0;
 }
 
 void FreeArena(Arena *arena)
 {
-    free(arena->memory);
-    arena->memory = nullptr;
-    arena->size = 0;
-}
\ No newline at end of file
+    FreeOverflowBlocks(arena, nullptr);
+    FreeMemory(arena);
+    *arena = (Arena){ 0 };
+}
@@ -1,29 +1,82 @@
 #ifndef C8VM_ARENA_H
 #define C8VM_ARENA_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+// The alignment of allocations requested without an explicit alignment, suitable for any fundamental type.
+#define ARENA_DEFAULT_ALIGNMENT alignof(max_align_t)
+
+// A block of memory chained onto an [Arena] when its pre-allocated memory runs out.
+typedef struct ArenaBlock ArenaBlock;
+
 // A block of pre-allocated memory that smaller blocks can be requested from.
+// Requests that don't fit are served from overflow blocks chained onto the arena, and the next reset grows the
+// pre-allocated memory to the high-water mark, so that a steady workload settles into a single block.
 typedef struct
 {
     size_t size;
     size_t offset;
     unsigned char *memory;
+
+    // The overflow blocks allocated since the last reset, most recent first.
+    ArenaBlock *overflowBlocks;
+
+    // The number of bytes used since the last reset, including alignment padding.
+    size_t used;
+
+    // The most bytes used between any two resets.
+    size_t highWaterMark;
+
+    // The number of overflow blocks allocated over the arena's lifetime.
+    uint64_t overflowCount;
+
+    // If true, the pre-allocated memory was mapped directly from the operating system rather than the C heap.
+    bool isPageMapped;
+
+    // If true, page-mapped memory is requested in huge pages where the operating system supports them.
+    bool useHugePages;
 } Arena;
 
+// The state of an [Arena] at a point in time, which it can be rolled back to.
+typedef struct
+{
+    size_t offset;
+    ArenaBlock *overflowBlocks;
+    size_t overflowOffset;
+    size_t used;
+} ArenaMarker;
+
 // Pre-allocates a new [Arena] of [size] bytes.
 Arena CreateArena(size_t size);
 
-// Requests [size] bytes from the [arena].
-// Returns a pointer to the requested block of memory if enough is available; otherwise, a null pointer.
+// Pre-allocates a new [Arena] of at least [size] bytes mapped directly from the operating system, which is page-aligned and zeroed.
+// If [useHugePages] is true, huge pages are requested (MAP_HUGETLB, then transparent huge pages, on Linux) to reduce TLB
+// pressure when the memory is spread across many objects. Falls back to the C heap where pages can't be mapped.
+Arena CreatePageArena(size_t size, bool useHugePages);
+
+// Requests [size] bytes from the [arena], aligned to ARENA_DEFAULT_ALIGNMENT.
+// Returns a pointer to the requested block of memory if it could be provided; otherwise, a null pointer.
 void *RequestAllocationFromArena(Arena *arena, size_t size);
 
+// Requests [size] bytes from the [arena], aligned to [alignment], which must be a power of two.
+// Returns a pointer to the requested block of memory if it could be provided; otherwise, a null pointer.
+void *RequestAlignedAllocationFromArena(Arena *arena, size_t size, size_t alignment);
+
+// Returns a marker that the [arena] can later be restored to with RestoreArena.
+ArenaMarker SaveArena(const Arena *arena);
+
+// Releases every allocation made from the [arena] since [marker] was saved.
+// Markers saved after [marker] must not be restored afterwards.
+void RestoreArena(Arena *arena, ArenaMarker marker);
+
 // Resets the internal memory offset of the [arena], but does not free or zero the memory.
 // After this function is called, the [arena] may still be used, but will overwrite any previously allocated memory.
+// Any overflow blocks are freed, and if the [arena] has ever needed more than its memory holds, the memory is grown to the high-water mark.
 void ResetArena(Arena *arena);
 
 // Frees the pre-allocated block of memory held by the [arena], and zeroes all fields.
 // After this function is called, the [arena] can no longer be used.
 void FreeArena(Arena *arena);
 
-#endif // C8VM_ARENA_H
\ No newline at end of file
+#endif // C8VM_ARENA_H
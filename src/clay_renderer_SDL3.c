@@ -1,178 +1,867 @@
 #include "clay.h"
 #include <SDL3/SDL.h>
+#ifndef C8VM_USE_GLYPH_ATLAS
 #include <SDL3_ttf/SDL_ttf.h>
+#endif
 
 #include "core.h"
+#ifdef C8VM_USE_GLYPH_ATLAS
+#include "glyph_atlas.h"
+#endif
+
+#ifndef C8VM_USE_GLYPH_ATLAS
+// The number of shaped text objects kept across frames, grouped into sets of TEXT_CACHE_WAYS entries by key hash.
+#define TEXT_CACHE_CAPACITY 512
+#define TEXT_CACHE_WAYS 4
+
+// The number of frames a cached text object may go unused before it is destroyed.
+#define TEXT_CACHE_EVICTION_FRAMES 120
+
+// The number of additional font handles opened for sizes other than a font's native size.
+#define FONT_VARIANT_CAPACITY 16
+
+// The number of text measurements cached, indexed directly by key hash.
+#define MEASUREMENT_CACHE_CAPACITY 1024
+
+typedef struct {
+    TTF_Font *font;
+    Uint16 fontId;
+    Uint16 fontSize;
+} FontVariant;
+
+typedef struct {
+    Uint64 hash;
+    int32_t length;
+    Uint16 fontId;
+    Uint16 fontSize;
+    bool isValid;
+    Clay_Dimensions dimensions;
+} MeasurementCacheEntry;
+
+typedef struct {
+    TTF_Text *text;
+    Uint64 hash;
+    Uint32 color;
+    Uint16 fontId;
+    Uint16 fontSize;
+    Uint64 frameLastUsed;
+} TextCacheEntry;
+
+#endif
+
+// The maximum number of separate regions redrawn into the cached UI layer per frame; any more are merged into one.
+#define LAYER_REGION_CAPACITY 8
+
+// The distance (in pixels) a command may draw outside its bounding box, e.g. border edges and anti-aliased arcs.
+#define LAYER_REGION_MARGIN 2
+
+// The identity and content of a render command drawn into the cached UI layer.
+typedef struct {
+    Uint32 id;
+    Uint64 hash;
+    SDL_Rect bounds;
+} LayerCommandRecord;
+
+// The number of vertices and indices the geometry batch starts with room for; it doubles whenever it fills up.
+#define BATCH_INITIAL_CAPACITY 1024
+
+// The number of distinct segment counts that quarter-circle tables are kept for.
+#define QUARTER_CIRCLE_TABLE_CAPACITY 32
+
+// The number of tessellated shapes kept between frames, direct-mapped by the hash of their dimensions.
+#define GEOMETRY_CACHE_CAPACITY 256
+
+// The points of a quarter circle of unit radius, divided into [segmentCount] equal segments.
+typedef struct {
+    int segmentCount;
+    SDL_FPoint *points;
+} QuarterCircleTable;
+
+typedef enum {
+    CACHED_SHAPE_ROUNDED_RECT = 1,
+    CACHED_SHAPE_ARC
+} CachedShape;
+
+// The dimensions a shape was tessellated with. Every field is 4 bytes, so keys can be hashed and compared bytewise.
+typedef struct {
+    CachedShape shape;
+    float width;
+    float height;
+    float radius;
+    float thickness;
+    float startAngle;
+    float endAngle;
+} GeometryKey;
+
+// A tessellated shape, positioned relative to the top-left corner of a rounded rectangle or the centre of an arc.
+typedef struct {
+    GeometryKey key;
+    SDL_FPoint *points;
+    int *indices;
+    int pointCount;
+    int indexCount;
+} CachedGeometry;
 
 typedef struct {
     SDL_Renderer *renderer;
+#ifdef C8VM_USE_GLYPH_ATLAS
+    SDL_Texture *glyphAtlasTexture;
+#else
     TTF_TextEngine *textEngine;
     TTF_Font **fonts;
+    FontVariant fontVariants[FONT_VARIANT_CAPACITY];
+    int fontVariantCount;
+    bool hasLoggedFontVariantCapacity;
+    MeasurementCacheEntry measurementCache[MEASUREMENT_CACHE_CAPACITY];
+    TextCacheEntry textCache[TEXT_CACHE_CAPACITY];
+#endif
+    SDL_Texture *displayTexture;
+    uint32_t displayGeneration;
+    SDL_Texture *layerTexture;
+    LayerCommandRecord *layerRecords;
+    int32_t layerRecordCount;
+    int32_t layerRecordCapacity;
+    bool isLayerInvalid;
+    Uint64 layerRedrawnPixels;
+    SDL_Texture *batchTexture;
+    SDL_Vertex *batchVertices;
+    int *batchIndices;
+    int batchVertexCount;
+    int batchIndexCount;
+    int batchVertexCapacity;
+    int batchIndexCapacity;
+    Uint64 batchSubmissions;
+    QuarterCircleTable quarterCircleTables[QUARTER_CIRCLE_TABLE_CAPACITY];
+    int quarterCircleTableCount;
+    CachedGeometry geometryCache[GEOMETRY_CACHE_CAPACITY];
+    CachedGeometry uncachedGeometry;
+    bool isGeometryCacheDisabled;
+    Uint64 frame;
+    Uint64 textCacheMisses;
 } Clay_SDL3RendererData;
 
+// The colour of a pixel, indexed by the bitmask of the bitplanes it is lit in.
+static const Uint32 C8DISPLAY_PALETTE[1 << XO_CHIP_PLANE_COUNT] = {
+    0xFF000000,
+    0xFFE6E6E6,
+    0xFF6E6E6E,
+    0xFFA8A8A8
+};
+
 /* Global for convenience. Even in 4K this is enough for smooth curves (low radius or rect size coupled with
  * no AA or low resolution might make it appear as jagged curves) */
 static int NUM_CIRCLE_SEGMENTS = 16;
 
-//all rendering is performed by a single SDL call, avoiding multiple RenderRect + plumbing choice for circles.
-static void SDL_Clay_RenderFillRoundedRect(Clay_SDL3RendererData *rendererData, const SDL_FRect rect, const float cornerRadius, const Clay_Color _color) {
-    const SDL_FColor color = { _color.r/255, _color.g/255, _color.b/255, _color.a/255 };
+// The initial value of a 64-bit FNV-1a hash.
+#define FNV_OFFSET_BASIS 0xCBF29CE484222325
 
-    int indexCount = 0, vertexCount = 0;
+// Continues a 64-bit FNV-1a hash over [size] bytes of [data].
+static Uint64 SDL_Clay_HashBytes(Uint64 hash, const void *data, const size_t size) {
+    const Uint8 *bytes = data;
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 0x100000001B3;
+    return hash;
+}
 
-    const float minRadius = SDL_min(rect.w, rect.h) / 2.0f;
-    const float clampedRadius = SDL_min(cornerRadius, minRadius);
+// Hashes a string with 64-bit FNV-1a.
+static Uint64 SDL_Clay_HashString(const char *chars, const int32_t length) {
+    return SDL_Clay_HashBytes(FNV_OFFSET_BASIS, chars, length);
+}
 
-    const int numCircleSegments = SDL_max(NUM_CIRCLE_SEGMENTS, (int) clampedRadius * 0.5f);
+static SDL_FColor SDL_Clay_ToFColor(const Clay_Color color) {
+    return (SDL_FColor){ color.r / 255, color.g / 255, color.b / 255, color.a / 255 };
+}
+
+// Submits the batched geometry with a single draw call.
+static void SDL_Clay_FlushBatch(Clay_SDL3RendererData *rendererData) {
+    if (rendererData->batchIndexCount == 0)
+        return;
+
+    // Untextured geometry is blended with the renderer's draw blend mode, which other draws may have changed.
+    SDL_SetRenderDrawBlendMode(rendererData->renderer, SDL_BLENDMODE_BLEND);
+    SDL_RenderGeometry(rendererData->renderer, rendererData->batchTexture, rendererData->batchVertices, rendererData->batchVertexCount, rendererData->batchIndices, rendererData->batchIndexCount);
+
+    rendererData->batchVertexCount = 0;
+    rendererData->batchIndexCount = 0;
+    ++rendererData->batchSubmissions;
+}
+
+static bool SDL_Clay_GrowBatchArray(void **array, int *capacity, const int required, const size_t elementSize) {
+    if (required <= *capacity)
+        return true;
+
+    int newCapacity = SDL_max(*capacity, BATCH_INITIAL_CAPACITY);
+    while (newCapacity < required)
+        newCapacity *= 2;
+
+    void *newArray = SDL_realloc(*array, newCapacity * elementSize);
+    if (!newArray)
+        return false;
+
+    *array = newArray;
+    *capacity = newCapacity;
+    return true;
+}
+
+// Makes room in the batch for [vertexCount] more vertices and [indexCount] more indices sampling [texture],
+// submitting the batch first if it samples a different texture.
+// Returns the index of the first reserved vertex, or -1 if the batch could not grow.
+static int SDL_Clay_ReserveBatch(Clay_SDL3RendererData *rendererData, SDL_Texture *texture, const int vertexCount, const int indexCount) {
+    if (texture != rendererData->batchTexture) {
+        SDL_Clay_FlushBatch(rendererData);
+        rendererData->batchTexture = texture;
+    }
+
+    if (!SDL_Clay_GrowBatchArray((void **)&rendererData->batchVertices, &rendererData->batchVertexCapacity, rendererData->batchVertexCount + vertexCount, sizeof(SDL_Vertex))
+        || !SDL_Clay_GrowBatchArray((void **)&rendererData->batchIndices, &rendererData->batchIndexCapacity, rendererData->batchIndexCount + indexCount, sizeof(int))) {
+        SDL_Log("Failed to grow the geometry batch.");
+        return -1;
+    }
+
+    return rendererData->batchVertexCount;
+}
+
+static void SDL_Clay_PushVertex(Clay_SDL3RendererData *rendererData, const float x, const float y, const SDL_FColor color, const SDL_FPoint uv) {
+    rendererData->batchVertices[rendererData->batchVertexCount++] = (SDL_Vertex){ { x, y }, color, uv };
+}
+
+static void SDL_Clay_PushTriangle(Clay_SDL3RendererData *rendererData, const int a, const int b, const int c) {
+    rendererData->batchIndices[rendererData->batchIndexCount++] = a;
+    rendererData->batchIndices[rendererData->batchIndexCount++] = b;
+    rendererData->batchIndices[rendererData->batchIndexCount++] = c;
+}
+
+// Returns the texture and texture coordinate that solid shapes are drawn with.
+// With the glyph atlas, shapes sample its solid square so that they can share a batch with text; otherwise, they are untextured.
+static SDL_Texture *SDL_Clay_GetSolidTexture(const Clay_SDL3RendererData *rendererData, SDL_FPoint *uv) {
+#ifdef C8VM_USE_GLYPH_ATLAS
+    *uv = (SDL_FPoint){ GLYPH_ATLAS_SOLID_SIZE / 2.0f / GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_SOLID_SIZE / 2.0f / GLYPH_ATLAS_HEIGHT };
+    return rendererData->glyphAtlasTexture;
+#else
+    (void)rendererData;
+    *uv = (SDL_FPoint){ 0, 0 };
+    return nullptr;
+#endif
+}
+
+// Adds a solid quad to the batch.
+static void SDL_Clay_BatchRect(Clay_SDL3RendererData *rendererData, const SDL_FRect rect, const SDL_FColor color) {
+    SDL_FPoint uv;
+    SDL_Texture *texture = SDL_Clay_GetSolidTexture(rendererData, &uv);
+
+    const int base = SDL_Clay_ReserveBatch(rendererData, texture, 4, 6);
+    if (base < 0)
+        return;
+
+    SDL_Clay_PushVertex(rendererData, rect.x, rect.y, color, uv);
+    SDL_Clay_PushVertex(rendererData, rect.x + rect.w, rect.y, color, uv);
+    SDL_Clay_PushVertex(rendererData, rect.x + rect.w, rect.y + rect.h, color, uv);
+    SDL_Clay_PushVertex(rendererData, rect.x, rect.y + rect.h, color, uv);
+    SDL_Clay_PushTriangle(rendererData, base, base + 1, base + 3);
+    SDL_Clay_PushTriangle(rendererData, base + 1, base + 2, base + 3);
+}
+
+// Returns the points of a unit quarter circle divided into [segmentCount] segments, computing them on first use.
+static const SDL_FPoint *SDL_Clay_GetQuarterCircle(Clay_SDL3RendererData *rendererData, const int segmentCount) {
+    for (int i = 0; i < rendererData->quarterCircleTableCount; ++i) {
+        if (rendererData->quarterCircleTables[i].segmentCount == segmentCount)
+            return rendererData->quarterCircleTables[i].points;
+    }
+
+    // Once every slot is taken, tables are replaced in turn; the returned points stay valid until the next call.
+    QuarterCircleTable *table;
+    if (rendererData->quarterCircleTableCount < QUARTER_CIRCLE_TABLE_CAPACITY) {
+        table = &rendererData->quarterCircleTables[rendererData->quarterCircleTableCount++];
+    } else {
+        table = &rendererData->quarterCircleTables[segmentCount % QUARTER_CIRCLE_TABLE_CAPACITY];
+        SDL_free(table->points);
+    }
+
+    table->segmentCount = segmentCount;
+    table->points = SDL_malloc((segmentCount + 1) * sizeof(SDL_FPoint));
+    if (!table->points) {
+        table->segmentCount = 0;
+        return nullptr;
+    }
+
+    const float step = (SDL_PI_F / 2) / segmentCount;
+    for (int i = 0; i <= segmentCount; ++i)
+        table->points[i] = (SDL_FPoint){ SDL_cosf(i * step), SDL_sinf(i * step) };
 
-    int totalVertices = 4 + (4 * (numCircleSegments * 2)) + 2*4;
-    int totalIndices = 6 + (4 * (numCircleSegments * 3)) + 6*4;
+    return table->points;
+}
+
+static bool SDL_Clay_AllocateGeometry(CachedGeometry *geometry, const int pointCount, const int indexCount) {
+    geometry->points = SDL_malloc(pointCount * sizeof(SDL_FPoint));
+    geometry->indices = SDL_malloc(indexCount * sizeof(int));
+    geometry->pointCount = 0;
+    geometry->indexCount = 0;
+    return geometry->points && geometry->indices;
+}
+
+static void SDL_Clay_FreeGeometry(CachedGeometry *geometry) {
+    SDL_free(geometry->points);
+    SDL_free(geometry->indices);
+    *geometry = (CachedGeometry){ 0 };
+}
+
+static void SDL_Clay_AddGeometryTriangle(CachedGeometry *geometry, const int a, const int b, const int c) {
+    geometry->indices[geometry->indexCount++] = a;
+    geometry->indices[geometry->indexCount++] = b;
+    geometry->indices[geometry->indexCount++] = c;
+}
+
+// Tessellates a rounded rectangle: a centre rectangle, four edge rectangles and a triangle fan for each corner.
+static bool SDL_Clay_TessellateRoundedRect(Clay_SDL3RendererData *rendererData, const GeometryKey *key, CachedGeometry *geometry) {
+    const float w = key->width, h = key->height;
+    const float minRadius = SDL_min(w, h) / 2.0f;
+    const float clampedRadius = SDL_min(key->radius, minRadius);
 
-    SDL_Vertex vertices[totalVertices];
-    int indices[totalIndices];
+    const int numCircleSegments = SDL_max(NUM_CIRCLE_SEGMENTS, (int) clampedRadius * 0.5f);
+    const SDL_FPoint *quarterCircle = SDL_Clay_GetQuarterCircle(rendererData, numCircleSegments);
+    if (!quarterCircle || !SDL_Clay_AllocateGeometry(geometry, 4 + 4 * (numCircleSegments + 1) + 2*4, 6 + 4 * (numCircleSegments * 3) + 6*4))
+        return false;
+
+    SDL_FPoint *points = geometry->points;
 
     //define center rectangle
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + clampedRadius, rect.y + clampedRadius}, color, {0, 0} }; //0 center TL
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + rect.w - clampedRadius, rect.y + clampedRadius}, color, {1, 0} }; //1 center TR
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + rect.w - clampedRadius, rect.y + rect.h - clampedRadius}, color, {1, 1} }; //2 center BR
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + clampedRadius, rect.y + rect.h - clampedRadius}, color, {0, 1} }; //3 center BL
-
-    indices[indexCount++] = 0;
-    indices[indexCount++] = 1;
-    indices[indexCount++] = 3;
-    indices[indexCount++] = 1;
-    indices[indexCount++] = 2;
-    indices[indexCount++] = 3;
-
-    //define rounded corners as triangle fans
-    const float step = (SDL_PI_F/2) / numCircleSegments;
-    for (int i = 0; i < numCircleSegments; i++) {
-        const float angle1 = (float)i * step;
-        const float angle2 = ((float)i + 1.0f) * step;
-
-        for (int j = 0; j < 4; j++) {  // Iterate over four corners
-            float cx, cy, signX, signY;
-
-            switch (j) {
-                case 0: cx = rect.x + clampedRadius; cy = rect.y + clampedRadius; signX = -1; signY = -1; break; // Top-left
-                case 1: cx = rect.x + rect.w - clampedRadius; cy = rect.y + clampedRadius; signX = 1; signY = -1; break; // Top-right
-                case 2: cx = rect.x + rect.w - clampedRadius; cy = rect.y + rect.h - clampedRadius; signX = 1; signY = 1; break; // Bottom-right
-                case 3: cx = rect.x + clampedRadius; cy = rect.y + rect.h - clampedRadius; signX = -1; signY = 1; break; // Bottom-left
-                default: return;
-            }
+    points[geometry->pointCount++] = (SDL_FPoint){ clampedRadius, clampedRadius }; //0 center TL
+    points[geometry->pointCount++] = (SDL_FPoint){ w - clampedRadius, clampedRadius }; //1 center TR
+    points[geometry->pointCount++] = (SDL_FPoint){ w - clampedRadius, h - clampedRadius }; //2 center BR
+    points[geometry->pointCount++] = (SDL_FPoint){ clampedRadius, h - clampedRadius }; //3 center BL
 
-            vertices[vertexCount++] = (SDL_Vertex){ {cx + SDL_cosf(angle1) * clampedRadius * signX, cy + SDL_sinf(angle1) * clampedRadius * signY}, color, {0, 0} };
-            vertices[vertexCount++] = (SDL_Vertex){ {cx + SDL_cosf(angle2) * clampedRadius * signX, cy + SDL_sinf(angle2) * clampedRadius * signY}, color, {0, 0} };
+    SDL_Clay_AddGeometryTriangle(geometry, 0, 1, 3);
+    SDL_Clay_AddGeometryTriangle(geometry, 1, 2, 3);
 
-            indices[indexCount++] = j;  // Connect to corresponding central rectangle vertex
-            indices[indexCount++] = vertexCount - 2;
-            indices[indexCount++] = vertexCount - 1;
+    //define rounded corners as triangle fans around the corresponding central rectangle vertex
+    static const float CORNER_SIGNS[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+    for (int j = 0; j < 4; j++) {
+        const SDL_FPoint center = points[j];
+        const int first = geometry->pointCount;
+        for (int i = 0; i <= numCircleSegments; i++) {
+            points[geometry->pointCount++] = (SDL_FPoint){
+                center.x + quarterCircle[i].x * clampedRadius * CORNER_SIGNS[j][0],
+                center.y + quarterCircle[i].y * clampedRadius * CORNER_SIGNS[j][1] };
+            if (i > 0)
+                SDL_Clay_AddGeometryTriangle(geometry, j, first + i - 1, first + i);
         }
     }
 
     //Define edge rectangles
     // Top edge
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + clampedRadius, rect.y}, color, {0, 0} }; //TL
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + rect.w - clampedRadius, rect.y}, color, {1, 0} }; //TR
-
-    indices[indexCount++] = 0;
-    indices[indexCount++] = vertexCount - 2; //TL
-    indices[indexCount++] = vertexCount - 1; //TR
-    indices[indexCount++] = 1;
-    indices[indexCount++] = 0;
-    indices[indexCount++] = vertexCount - 1; //TR
+    points[geometry->pointCount++] = (SDL_FPoint){ clampedRadius, 0 }; //TL
+    points[geometry->pointCount++] = (SDL_FPoint){ w - clampedRadius, 0 }; //TR
+    SDL_Clay_AddGeometryTriangle(geometry, 0, geometry->pointCount - 2, geometry->pointCount - 1);
+    SDL_Clay_AddGeometryTriangle(geometry, 1, 0, geometry->pointCount - 1);
     // Right edge
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + rect.w, rect.y + clampedRadius}, color, {1, 0} }; //RT
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + rect.w, rect.y + rect.h - clampedRadius}, color, {1, 1} }; //RB
-
-    indices[indexCount++] = 1;
-    indices[indexCount++] = vertexCount - 2; //RT
-    indices[indexCount++] = vertexCount - 1; //RB
-    indices[indexCount++] = 2;
-    indices[indexCount++] = 1;
-    indices[indexCount++] = vertexCount - 1; //RB
+    points[geometry->pointCount++] = (SDL_FPoint){ w, clampedRadius }; //RT
+    points[geometry->pointCount++] = (SDL_FPoint){ w, h - clampedRadius }; //RB
+    SDL_Clay_AddGeometryTriangle(geometry, 1, geometry->pointCount - 2, geometry->pointCount - 1);
+    SDL_Clay_AddGeometryTriangle(geometry, 2, 1, geometry->pointCount - 1);
     // Bottom edge
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + rect.w - clampedRadius, rect.y + rect.h}, color, {1, 1} }; //BR
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + clampedRadius, rect.y + rect.h}, color, {0, 1} }; //BL
-
-    indices[indexCount++] = 2;
-    indices[indexCount++] = vertexCount - 2; //BR
-    indices[indexCount++] = vertexCount - 1; //BL
-    indices[indexCount++] = 3;
-    indices[indexCount++] = 2;
-    indices[indexCount++] = vertexCount - 1; //BL
+    points[geometry->pointCount++] = (SDL_FPoint){ w - clampedRadius, h }; //BR
+    points[geometry->pointCount++] = (SDL_FPoint){ clampedRadius, h }; //BL
+    SDL_Clay_AddGeometryTriangle(geometry, 2, geometry->pointCount - 2, geometry->pointCount - 1);
+    SDL_Clay_AddGeometryTriangle(geometry, 3, 2, geometry->pointCount - 1);
     // Left edge
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x, rect.y + rect.h - clampedRadius}, color, {0, 1} }; //LB
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x, rect.y + clampedRadius}, color, {0, 0} }; //LT
+    points[geometry->pointCount++] = (SDL_FPoint){ 0, h - clampedRadius }; //LB
+    points[geometry->pointCount++] = (SDL_FPoint){ 0, clampedRadius }; //LT
+    SDL_Clay_AddGeometryTriangle(geometry, 3, geometry->pointCount - 2, geometry->pointCount - 1);
+    SDL_Clay_AddGeometryTriangle(geometry, 0, 3, geometry->pointCount - 1);
+    return true;
+}
+
+// Tessellates an arc as a strip of quads running inwards from its radius.
+// Arcs covering a single quadrant are rotated from the quarter-circle table; any others fall back to computing each point.
+static bool SDL_Clay_TessellateArc(Clay_SDL3RendererData *rendererData, const GeometryKey *key, CachedGeometry *geometry) {
+    const float radStart = key->startAngle * (SDL_PI_F / 180.0f);
+    const float radEnd = key->endAngle * (SDL_PI_F / 180.0f);
+
+    const int numCircleSegments = SDL_max(NUM_CIRCLE_SEGMENTS, (int)(key->radius * 1.5f)); //increase circle segments for larger circles, 1.5 is arbitrary.
+
+    const float angleStep = (radEnd - radStart) / (float)numCircleSegments;
+    const float innerRadius = SDL_max(key->radius - key->thickness, 0.0f);
+
+    const int quadrant = (int)(key->startAngle / 90.0f);
+    const bool isQuadrant = key->endAngle - key->startAngle == 90.0f && key->startAngle == quadrant * 90.0f;
+    const SDL_FPoint *quarterCircle = isQuadrant ? SDL_Clay_GetQuarterCircle(rendererData, numCircleSegments) : nullptr;
+
+    if (!SDL_Clay_AllocateGeometry(geometry, (numCircleSegments + 1) * 2, numCircleSegments * 6))
+        return false;
+
+    for (int i = 0; i <= numCircleSegments; i++) {
+        float cos, sin;
+        if (quarterCircle) {
+            // Rotating by a multiple of 90 degrees only swaps and negates the components.
+            const SDL_FPoint point = quarterCircle[i];
+            switch (quadrant & 3) {
+                case 0: cos = point.x; sin = point.y; break;
+                case 1: cos = -point.y; sin = point.x; break;
+                case 2: cos = -point.x; sin = -point.y; break;
+                default: cos = point.y; sin = -point.x; break;
+            }
+        } else {
+            const float angle = radStart + i * angleStep;
+            cos = SDL_cosf(angle);
+            sin = SDL_sinf(angle);
+        }
+
+        geometry->points[geometry->pointCount++] = (SDL_FPoint){ cos * key->radius, sin * key->radius };
+        geometry->points[geometry->pointCount++] = (SDL_FPoint){ cos * innerRadius, sin * innerRadius };
+
+        if (i > 0) {
+            const int outer = i * 2;
+            SDL_Clay_AddGeometryTriangle(geometry, outer - 2, outer, outer - 1);
+            SDL_Clay_AddGeometryTriangle(geometry, outer, outer + 1, outer - 1);
+        }
+    }
+
+    return true;
+}
+
+// Returns the tessellation of the shape described by [key], reusing the one from an earlier frame if it is cached.
+static const CachedGeometry *SDL_Clay_GetGeometry(Clay_SDL3RendererData *rendererData, const GeometryKey *key) {
+    CachedGeometry *geometry = &rendererData->uncachedGeometry;
+    if (!rendererData->isGeometryCacheDisabled) {
+        geometry = &rendererData->geometryCache[SDL_Clay_HashBytes(FNV_OFFSET_BASIS, key, sizeof(GeometryKey)) % GEOMETRY_CACHE_CAPACITY];
+        if (geometry->points && SDL_memcmp(&geometry->key, key, sizeof(GeometryKey)) == 0)
+            return geometry;
+    }
 
-    indices[indexCount++] = 3;
-    indices[indexCount++] = vertexCount - 2; //LB
-    indices[indexCount++] = vertexCount - 1; //LT
-    indices[indexCount++] = 0;
-    indices[indexCount++] = 3;
-    indices[indexCount++] = vertexCount - 1; //LT
+    SDL_Clay_FreeGeometry(geometry);
 
-    // Render everything
-    SDL_RenderGeometry(rendererData->renderer, NULL, vertices, vertexCount, indices, indexCount);
+    const bool isTessellated = key->shape == CACHED_SHAPE_ARC
+        ? SDL_Clay_TessellateArc(rendererData, key, geometry)
+        : SDL_Clay_TessellateRoundedRect(rendererData, key, geometry);
+
+    if (!isTessellated) {
+        SDL_Clay_FreeGeometry(geometry);
+        return nullptr;
+    }
+
+    geometry->key = *key;
+    return geometry;
+}
+
+// Adds a tessellated shape to the batch, translated by [offset].
+static void SDL_Clay_BatchGeometry(Clay_SDL3RendererData *rendererData, const CachedGeometry *geometry, const SDL_FPoint offset, const SDL_FColor color) {
+    SDL_FPoint uv;
+    SDL_Texture *texture = SDL_Clay_GetSolidTexture(rendererData, &uv);
+
+    const int base = SDL_Clay_ReserveBatch(rendererData, texture, geometry->pointCount, geometry->indexCount);
+    if (base < 0)
+        return;
+
+    for (int i = 0; i < geometry->pointCount; ++i)
+        SDL_Clay_PushVertex(rendererData, offset.x + geometry->points[i].x, offset.y + geometry->points[i].y, color, uv);
+
+    for (int i = 0; i < geometry->indexCount; ++i)
+        rendererData->batchIndices[rendererData->batchIndexCount++] = base + geometry->indices[i];
+}
+
+static void SDL_Clay_RenderFillRoundedRect(Clay_SDL3RendererData *rendererData, const SDL_FRect rect, const float cornerRadius, const Clay_Color color) {
+    const GeometryKey key = { .shape = CACHED_SHAPE_ROUNDED_RECT, .width = rect.w, .height = rect.h, .radius = cornerRadius };
+    const CachedGeometry *geometry = SDL_Clay_GetGeometry(rendererData, &key);
+    if (geometry)
+        SDL_Clay_BatchGeometry(rendererData, geometry, (SDL_FPoint){ rect.x, rect.y }, SDL_Clay_ToFColor(color));
 }
 
 static void SDL_Clay_RenderArc(Clay_SDL3RendererData *rendererData, const SDL_FPoint center, const float radius, const float startAngle, const float endAngle, const float thickness, const Clay_Color color) {
-    SDL_SetRenderDrawColor(rendererData->renderer, color.r, color.g, color.b, color.a);
+    const GeometryKey key = { .shape = CACHED_SHAPE_ARC, .radius = radius, .thickness = thickness, .startAngle = startAngle, .endAngle = endAngle };
+    const CachedGeometry *geometry = SDL_Clay_GetGeometry(rendererData, &key);
+    if (geometry)
+        SDL_Clay_BatchGeometry(rendererData, geometry, center, SDL_Clay_ToFColor(color));
+}
 
-    const float radStart = startAngle * (SDL_PI_F / 180.0f);
-    const float radEnd = endAngle * (SDL_PI_F / 180.0f);
+static void SDL_Clay_FreeGeometryCache(Clay_SDL3RendererData *rendererData) {
+    for (int i = 0; i < rendererData->quarterCircleTableCount; ++i)
+        SDL_free(rendererData->quarterCircleTables[i].points);
+    rendererData->quarterCircleTableCount = 0;
 
-    const int numCircleSegments = SDL_max(NUM_CIRCLE_SEGMENTS, (int)(radius * 1.5f)); //increase circle segments for larger circles, 1.5 is arbitrary.
+    for (int i = 0; i < GEOMETRY_CACHE_CAPACITY; ++i)
+        SDL_Clay_FreeGeometry(&rendererData->geometryCache[i]);
+    SDL_Clay_FreeGeometry(&rendererData->uncachedGeometry);
+}
 
-    const float angleStep = (radEnd - radStart) / (float)numCircleSegments;
-    const float thicknessStep = 0.4f; //arbitrary value to avoid overlapping lines. Changing THICKNESS_STEP or numCircleSegments might cause artifacts.
+static void SDL_Clay_FreeBatch(Clay_SDL3RendererData *rendererData) {
+    SDL_free(rendererData->batchVertices);
+    SDL_free(rendererData->batchIndices);
 
-    for (float t = thicknessStep; t < thickness - thicknessStep; t += thicknessStep) {
-        SDL_FPoint points[numCircleSegments + 1];
-        const float clampedRadius = SDL_max(radius - t, 1.0f);
+    rendererData->batchVertices = nullptr;
+    rendererData->batchIndices = nullptr;
+    rendererData->batchVertexCount = rendererData->batchIndexCount = 0;
+    rendererData->batchVertexCapacity = rendererData->batchIndexCapacity = 0;
+}
 
-        for (int i = 0; i <= numCircleSegments; i++) {
-            const float angle = radStart + i * angleStep;
-            points[i] = (SDL_FPoint){
-                    SDL_roundf(center.x + SDL_cosf(angle) * clampedRadius),
-                    SDL_roundf(center.y + SDL_sinf(angle) * clampedRadius) };
+// Composites a run of [rowCount] framebuffer rows, starting at [firstRow], into the display texture.
+static bool SDL_Clay_UploadC8DisplayRows(Clay_SDL3RendererData *rendererData, const C8_Instance *instance, const int firstRow, const int rowCount) {
+    const int width = C8_GetDisplayWidth(instance);
+    const SDL_Rect region = { 0, firstRow, width, rowCount };
+
+    void *pixels;
+    int pitch;
+    if (!SDL_LockTexture(rendererData->displayTexture, &region, &pixels, &pitch))
+        return false;
+
+    for (int i = 0; i < rowCount; ++i) {
+        Uint32 *texel = (Uint32 *)((Uint8 *)pixels + i * pitch);
+        for (int word = 0; word < width / C8_PIXELS_PER_WORD; ++word) {
+            // Gather each bitplane's word once, then composite 64 pixels at a time by shifting them out together.
+            Uint64 planes[XO_CHIP_PLANE_COUNT] = { 0 };
+            for (Uint8 plane = 0; plane < instance->planeCount; ++plane)
+                planes[plane] = C8_GetDisplayRow(instance, plane, firstRow + i)[word];
+
+            for (int bit = 0; bit < C8_PIXELS_PER_WORD; ++bit) {
+                const int shift = C8_PIXELS_PER_WORD - 1 - bit;
+                const Uint8 color = (planes[0] >> shift & 1) | (planes[1] >> shift & 1) << 1;
+                *texel++ = C8DISPLAY_PALETTE[color];
+            }
         }
-        SDL_RenderLines(rendererData->renderer, points, numCircleSegments + 1);
     }
+
+    SDL_UnlockTexture(rendererData->displayTexture);
+    return true;
 }
 
-static void SDL_Clay_RenderClayCommands(Clay_SDL3RendererData *rendererData, Clay_RenderCommandArray *rcommands)
+// Uploads the changed rows of the virtual machine's framebuffer into the display texture and draws it scaled to fill [rect].
+// The texture is created once at the largest resolution, so switching between display modes only changes the region used.
+static void SDL_Clay_RenderC8Display(Clay_SDL3RendererData *rendererData, const C8_Instance *instance, const SDL_FRect rect) {
+    // The instance may have been reset earlier in the frame, e.g. when exiting to the menu.
+    if (!instance->framebuffer)
+        return;
+
+    // The renderer tracks the generation it last uploaded itself, leaving the instance's state untouched for other consumers.
+    uint64_t dirtyRows = C8_GetDirtyRows(instance, rendererData->displayGeneration);
+
+    if (!rendererData->displayTexture) {
+        rendererData->displayTexture = SDL_CreateTexture(rendererData->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SUPER_CHIP_DISPLAY_WIDTH, SUPER_CHIP_DISPLAY_HEIGHT);
+        if (!rendererData->displayTexture) {
+            SDL_Log("SDL_CreateTexture failed: %s", SDL_GetError());
+            return;
+        }
+        SDL_SetTextureScaleMode(rendererData->displayTexture, SDL_SCALEMODE_NEAREST);
+        dirtyRows = UINT64_MAX;
+    }
+
+    const int width = C8_GetDisplayWidth(instance);
+    const int height = C8_GetDisplayHeight(instance);
+
+    // Rows are uploaded in contiguous runs, so a typical sprite draw locks a single small region of the texture.
+    for (int y = 0; y < height; ++y) {
+        if (!(dirtyRows >> y & 1))
+            continue;
+
+        const int firstRow = y;
+        while (y < height && dirtyRows >> y & 1)
+            ++y;
+
+        if (!SDL_Clay_UploadC8DisplayRows(rendererData, instance, firstRow, y - firstRow))
+            return;
+    }
+
+    rendererData->displayGeneration = instance->displayGeneration;
+
+    const SDL_FRect source = { 0, 0, (float)width, (float)height };
+    SDL_RenderTexture(rendererData->renderer, rendererData->displayTexture, &source, &rect);
+}
+
+#ifdef C8VM_USE_GLYPH_ATLAS
+// Uploads the baked glyph atlas into a texture, storing each pixel's coverage as the alpha of a white texel
+// so that text can be coloured by the colour of the vertices it is drawn with.
+static bool SDL_Clay_CreateGlyphAtlasTexture(Clay_SDL3RendererData *rendererData) {
+    const int pixelCount = GLYPH_ATLAS_WIDTH * GLYPH_ATLAS_HEIGHT;
+    Uint32 *texels = SDL_malloc(pixelCount * sizeof(Uint32));
+    if (!texels)
+        return false;
+
+    for (int i = 0; i < pixelCount; ++i)
+        texels[i] = (Uint32)GLYPH_ATLAS_PIXELS[i] << 24 | 0x00FFFFFF;
+
+    rendererData->glyphAtlasTexture = SDL_CreateTexture(rendererData->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT);
+    const bool isCreated = rendererData->glyphAtlasTexture && SDL_UpdateTexture(rendererData->glyphAtlasTexture, nullptr, texels, GLYPH_ATLAS_WIDTH * sizeof(Uint32));
+    SDL_free(texels);
+
+    if (!isCreated)
+        return false;
+
+    SDL_SetTextureBlendMode(rendererData->glyphAtlasTexture, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureScaleMode(rendererData->glyphAtlasTexture, SDL_SCALEMODE_NEAREST);
+    return true;
+}
+
+static const BakedGlyph *SDL_Clay_GetBakedGlyph(const BakedFont *font, char character) {
+    if (character < GLYPH_ATLAS_FIRST_CHARACTER || character > GLYPH_ATLAS_LAST_CHARACTER)
+        character = GLYPH_ATLAS_FALLBACK;
+    return &font->glyphs[character - GLYPH_ATLAS_FIRST_CHARACTER];
+}
+
+// Measures text for Clay from the baked glyph metrics.
+// Sizes other than a font's baked size are scaled from it, which keeps pixel fonts crisp at integer multiples.
+static Clay_Dimensions SDL_Clay_MeasureText(const Clay_StringSlice text, Clay_TextElementConfig *config, void *userData) {
+    (void)userData;
+
+    const BakedFont *font = &BAKED_FONTS[config->fontId];
+    const float scale = (float)config->fontSize / font->size;
+
+    int width = 0;
+    for (int32_t i = 0; i < text.length; ++i)
+        width += SDL_Clay_GetBakedGlyph(font, text.chars[i])->advance;
+
+    return (Clay_Dimensions){ width * scale, font->lineHeight * scale };
+}
+
+// Adds a quad for each glyph of the text to the batch, coloured by its vertices.
+static void SDL_Clay_RenderBakedText(Clay_SDL3RendererData *rendererData, const Clay_TextRenderData *config, const SDL_FRect rect) {
+    const BakedFont *font = &BAKED_FONTS[config->fontId];
+    const float scale = (float)config->fontSize / font->size;
+    const SDL_FColor color = SDL_Clay_ToFColor(config->textColor);
+
+    const int32_t length = config->stringContents.length;
+    if (SDL_Clay_ReserveBatch(rendererData, rendererData->glyphAtlasTexture, length * 4, length * 6) < 0)
+        return;
+
+    float penX = rect.x;
+    for (int32_t i = 0; i < length; ++i) {
+        const BakedGlyph *glyph = SDL_Clay_GetBakedGlyph(font, config->stringContents.chars[i]);
+        if (glyph->width > 0) {
+            const float left = penX + glyph->offsetX * scale;
+            const float top = rect.y + glyph->offsetY * scale;
+            const float right = left + glyph->width * scale;
+            const float bottom = top + glyph->height * scale;
+
+            const float u0 = (float)glyph->x / GLYPH_ATLAS_WIDTH;
+            const float v0 = (float)glyph->y / GLYPH_ATLAS_HEIGHT;
+            const float u1 = (float)(glyph->x + glyph->width) / GLYPH_ATLAS_WIDTH;
+            const float v1 = (float)(glyph->y + glyph->height) / GLYPH_ATLAS_HEIGHT;
+
+            const int vertex = rendererData->batchVertexCount;
+            SDL_Clay_PushVertex(rendererData, left, top, color, (SDL_FPoint){ u0, v0 });
+            SDL_Clay_PushVertex(rendererData, right, top, color, (SDL_FPoint){ u1, v0 });
+            SDL_Clay_PushVertex(rendererData, right, bottom, color, (SDL_FPoint){ u1, v1 });
+            SDL_Clay_PushVertex(rendererData, left, bottom, color, (SDL_FPoint){ u0, v1 });
+            SDL_Clay_PushTriangle(rendererData, vertex, vertex + 1, vertex + 3);
+            SDL_Clay_PushTriangle(rendererData, vertex + 1, vertex + 2, vertex + 3);
+        }
+        penX += glyph->advance * scale;
+    }
+}
+#else
+
+// Returns a font handle for [fontId] at [fontSize], so that a shared font is never resized between uses.
+// Each font is opened at its native size; other sizes are copied from it once and kept until SDL_Clay_CloseFontVariants.
+static TTF_Font *SDL_Clay_GetFont(Clay_SDL3RendererData *rendererData, const Uint16 fontId, const Uint16 fontSize) {
+    TTF_Font *font = rendererData->fonts[fontId];
+    if (TTF_GetFontSize(font) == fontSize)
+        return font;
+
+    for (int i = 0; i < rendererData->fontVariantCount; ++i) {
+        const FontVariant *variant = &rendererData->fontVariants[i];
+        if (variant->fontId == fontId && variant->fontSize == fontSize)
+            return variant->font;
+    }
+
+    // Without room for another variant, fall back to the font's native size rather than resizing it.
+    // This is logged once, as it would otherwise repeat for every piece of text drawn at the size.
+    if (rendererData->fontVariantCount == FONT_VARIANT_CAPACITY) {
+        if (!rendererData->hasLoggedFontVariantCapacity) {
+            SDL_Log("Font variant capacity of %d reached, drawing font %d at its native size instead of size %d", FONT_VARIANT_CAPACITY, fontId, fontSize);
+            rendererData->hasLoggedFontVariantCapacity = true;
+        }
+        return font;
+    }
+
+    TTF_Font *variant = TTF_CopyFont(font);
+    if (!variant || !TTF_SetFontSize(variant, fontSize)) {
+        SDL_Log("Failed to open font %d at size %d: %s", fontId, fontSize, SDL_GetError());
+        if (variant)
+            TTF_CloseFont(variant);
+        return font;
+    }
+
+    rendererData->fontVariants[rendererData->fontVariantCount++] = (FontVariant){
+        .font = variant,
+        .fontId = fontId,
+        .fontSize = fontSize
+    };
+    return variant;
+}
+
+static void SDL_Clay_CloseFontVariants(Clay_SDL3RendererData *rendererData) {
+    for (int i = 0; i < rendererData->fontVariantCount; ++i)
+        TTF_CloseFont(rendererData->fontVariants[i].font);
+    rendererData->fontVariantCount = 0;
+    rendererData->hasLoggedFontVariantCapacity = false;
+}
+
+// Measures text for Clay, caching the result by font, size and string hash.
+// Clay lays out every drawn frame, so after the first frame of a screen most measurements are served from the cache.
+static Clay_Dimensions SDL_Clay_MeasureText(const Clay_StringSlice text, Clay_TextElementConfig *config, void *userData) {
+    Clay_SDL3RendererData *rendererData = userData;
+
+    const Uint64 hash = SDL_Clay_HashString(text.chars, text.length);
+    const Uint64 key = hash ^ ((Uint64)config->fontId << 48 | (Uint64)config->fontSize << 32);
+    MeasurementCacheEntry *entry = &rendererData->measurementCache[key % MEASUREMENT_CACHE_CAPACITY];
+
+    if (entry->isValid && entry->hash == hash && entry->length == text.length && entry->fontId == config->fontId && entry->fontSize == config->fontSize)
+        return entry->dimensions;
+
+    int width, height;
+    TTF_Font *font = SDL_Clay_GetFont(rendererData, config->fontId, config->fontSize);
+    if (!TTF_GetStringSize(font, text.chars, text.length, &width, &height))
+        return (Clay_Dimensions){ 0 };
+
+    *entry = (MeasurementCacheEntry){
+        .hash = hash,
+        .length = text.length,
+        .fontId = config->fontId,
+        .fontSize = config->fontSize,
+        .isValid = true,
+        .dimensions = { (float)width, (float)height }
+    };
+    return entry->dimensions;
+}
+
+// Returns a shaped text object for the text render command, creating and caching it if it isn't already cached.
+// When a set is full, its least recently used entry is replaced.
+static TTF_Text *SDL_Clay_GetCachedText(Clay_SDL3RendererData *rendererData, const Clay_TextRenderData *config) {
+    const Uint64 hash = SDL_Clay_HashString(config->stringContents.chars, config->stringContents.length);
+    const Uint32 color = (Uint32)config->textColor.r << 24 | (Uint32)config->textColor.g << 16 | (Uint32)config->textColor.b << 8 | (Uint32)config->textColor.a;
+
+    const Uint64 setHash = hash ^ ((Uint64)config->fontId << 48 | (Uint64)config->fontSize << 32 | color);
+    TextCacheEntry *set = &rendererData->textCache[setHash % (TEXT_CACHE_CAPACITY / TEXT_CACHE_WAYS) * TEXT_CACHE_WAYS];
+    TextCacheEntry *victim = &set[0];
+
+    for (int way = 0; way < TEXT_CACHE_WAYS; ++way) {
+        TextCacheEntry *entry = &set[way];
+        if (!entry->text) {
+            victim = entry;
+            continue;
+        }
+
+        // The hash only narrows the search; the text object's own copy of the string confirms the match.
+        if (entry->hash == hash && entry->color == color && entry->fontId == config->fontId && entry->fontSize == config->fontSize
+            && SDL_memcmp(entry->text->text, config->stringContents.chars, config->stringContents.length) == 0
+            && entry->text->text[config->stringContents.length] == '\0') {
+            entry->frameLastUsed = rendererData->frame;
+            return entry->text;
+        }
+
+        if (victim->text && entry->frameLastUsed < victim->frameLastUsed)
+            victim = entry;
+    }
+
+    ++rendererData->textCacheMisses;
+
+    TTF_Font *font = SDL_Clay_GetFont(rendererData, config->fontId, config->fontSize);
+    TTF_Text *text = TTF_CreateText(rendererData->textEngine, font, config->stringContents.chars, config->stringContents.length);
+    if (!text)
+        return nullptr;
+    TTF_SetTextColor(text, config->textColor.r, config->textColor.g, config->textColor.b, config->textColor.a);
+
+    if (victim->text)
+        TTF_DestroyText(victim->text);
+
+    *victim = (TextCacheEntry){
+        .text = text,
+        .hash = hash,
+        .color = color,
+        .fontId = config->fontId,
+        .fontSize = config->fontSize,
+        .frameLastUsed = rendererData->frame
+    };
+    return text;
+}
+
+// Destroys cached text objects that have gone unused for TEXT_CACHE_EVICTION_FRAMES frames, or all of them if [isDestroyingAll].
+static void SDL_Clay_EvictCachedText(Clay_SDL3RendererData *rendererData, const bool isDestroyingAll) {
+    for (int i = 0; i < TEXT_CACHE_CAPACITY; ++i) {
+        TextCacheEntry *entry = &rendererData->textCache[i];
+        if (entry->text && (isDestroyingAll || rendererData->frame - entry->frameLastUsed > TEXT_CACHE_EVICTION_FRAMES)) {
+            TTF_DestroyText(entry->text);
+            *entry = (TextCacheEntry){ 0 };
+        }
+    }
+}
+
+#endif
+
+// Returns the area a render command may draw to.
+static SDL_Rect SDL_Clay_GetCommandBounds(const Clay_RenderCommand *rcmd) {
+    const Clay_BoundingBox box = rcmd->boundingBox;
+    return (SDL_Rect){
+        (int)SDL_floorf(box.x) - LAYER_REGION_MARGIN,
+        (int)SDL_floorf(box.y) - LAYER_REGION_MARGIN,
+        (int)SDL_ceilf(box.width) + 2 * LAYER_REGION_MARGIN + 1,
+        (int)SDL_ceilf(box.height) + 2 * LAYER_REGION_MARGIN + 1
+    };
+}
+
+// Hashes everything about a render command that affects what it draws.
+static Uint64 SDL_Clay_HashCommand(const Clay_RenderCommand *rcmd) {
+    Uint64 hash = SDL_Clay_HashBytes(FNV_OFFSET_BASIS, &rcmd->commandType, sizeof(rcmd->commandType));
+    hash = SDL_Clay_HashBytes(hash, &rcmd->boundingBox, sizeof(rcmd->boundingBox));
+
+    switch (rcmd->commandType) {
+        case CLAY_RENDER_COMMAND_TYPE_RECTANGLE: {
+            const Clay_RectangleRenderData *data = &rcmd->renderData.rectangle;
+            hash = SDL_Clay_HashBytes(hash, &data->backgroundColor, sizeof(data->backgroundColor));
+            hash = SDL_Clay_HashBytes(hash, &data->cornerRadius, sizeof(data->cornerRadius));
+            break;
+        }
+        case CLAY_RENDER_COMMAND_TYPE_BORDER: {
+            const Clay_BorderRenderData *data = &rcmd->renderData.border;
+            hash = SDL_Clay_HashBytes(hash, &data->color, sizeof(data->color));
+            hash = SDL_Clay_HashBytes(hash, &data->cornerRadius, sizeof(data->cornerRadius));
+            hash = SDL_Clay_HashBytes(hash, &data->width, sizeof(data->width));
+            break;
+        }
+        case CLAY_RENDER_COMMAND_TYPE_TEXT: {
+            const Clay_TextRenderData *data = &rcmd->renderData.text;
+            hash = SDL_Clay_HashBytes(hash, data->stringContents.chars, data->stringContents.length);
+            hash = SDL_Clay_HashBytes(hash, &data->textColor, sizeof(data->textColor));
+            hash = SDL_Clay_HashBytes(hash, &data->fontId, sizeof(data->fontId));
+            hash = SDL_Clay_HashBytes(hash, &data->fontSize, sizeof(data->fontSize));
+            hash = SDL_Clay_HashBytes(hash, &data->letterSpacing, sizeof(data->letterSpacing));
+            hash = SDL_Clay_HashBytes(hash, &data->lineHeight, sizeof(data->lineHeight));
+            break;
+        }
+        case CLAY_RENDER_COMMAND_TYPE_IMAGE:
+            hash = SDL_Clay_HashBytes(hash, &rcmd->renderData.image.imageData, sizeof(rcmd->renderData.image.imageData));
+            break;
+        default:
+            break;
+    }
+
+    return hash;
+}
+
+// Draws the render commands from [first] up to [end].
+// If [region] is provided, drawing is clipped to it and commands that don't touch it are skipped.
+static void SDL_Clay_RenderCommandRange(Clay_SDL3RendererData *rendererData, Clay_RenderCommandArray *rcommands, const int32_t first, const int32_t end, const SDL_Rect *region)
 {
     SDL_Rect currentClippingRectangle;
-    for (size_t i = 0; i < rcommands->length; i++) {
+    bool isClippedOut = false;
+    for (int32_t i = first; i < end; i++) {
         Clay_RenderCommand *rcmd = Clay_RenderCommandArray_Get(rcommands, i);
         const Clay_BoundingBox bounding_box = rcmd->boundingBox;
         const SDL_FRect rect = { (int)bounding_box.x, (int)bounding_box.y, (int)bounding_box.width, (int)bounding_box.height };
 
+        if (rcmd->commandType != CLAY_RENDER_COMMAND_TYPE_SCISSOR_START && rcmd->commandType != CLAY_RENDER_COMMAND_TYPE_SCISSOR_END) {
+            const SDL_Rect bounds = SDL_Clay_GetCommandBounds(rcmd);
+            if (isClippedOut || (region && !SDL_HasRectIntersection(&bounds, region)))
+                continue;
+        }
+
         switch (rcmd->commandType) {
             case CLAY_RENDER_COMMAND_TYPE_CUSTOM:
             {
+                SDL_Clay_FlushBatch(rendererData);
                 const CustomElementData *customElementData = rcmd->renderData.custom.customData;
                 switch (customElementData->type)
                 {
                     case CUSTOM_ELEMENT_TYPE_C8DISPLAY:
-                    {
-                        SDL_SetRenderDrawColor(rendererData->renderer, 0, 0, 0, 255);
-                        SDL_RenderFillRect(rendererData->renderer, &rect);
-                        SDL_SetRenderDrawColor(rendererData->renderer, 230, 230, 230, 255);
-
-                        float scaleX, scaleY;
-                        SDL_GetRenderScale(rendererData->renderer, &scaleX, &scaleY);
-                        SDL_SetRenderScale(rendererData->renderer, rect.w / 64, rect.h / 32);
-
-                        for (uint8_t x = 0; x < 64; ++x)
-                            for (uint8_t y = 0; y < 32; ++y)
-                                if (customElementData->virtualMachine->instance.framebuffer[y * 64 + x])
-                                    SDL_RenderPoint(rendererData->renderer, x, y);
-
-                        SDL_SetRenderScale(rendererData->renderer, scaleX, scaleY);
+                        SDL_Clay_RenderC8Display(rendererData, &customElementData->virtualMachine->instance, rect);
                         break;
-                    }
                     default:
                         SDL_Log("Unknown custom element type: %d", customElementData->type);
                         break;
@@ -181,22 +870,22 @@ static void SDL_Clay_RenderClayCommands(Clay_SDL3RendererData *rendererData, Cla
             }
             case CLAY_RENDER_COMMAND_TYPE_RECTANGLE: {
                 Clay_RectangleRenderData *config = &rcmd->renderData.rectangle;
-                SDL_SetRenderDrawBlendMode(rendererData->renderer, SDL_BLENDMODE_BLEND);
-                SDL_SetRenderDrawColor(rendererData->renderer, config->backgroundColor.r, config->backgroundColor.g, config->backgroundColor.b, config->backgroundColor.a);
                 if (config->cornerRadius.topLeft > 0) {
                     SDL_Clay_RenderFillRoundedRect(rendererData, rect, config->cornerRadius.topLeft, config->backgroundColor);
                 } else {
-                    SDL_RenderFillRect(rendererData->renderer, &rect);
+                    SDL_Clay_BatchRect(rendererData, rect, SDL_Clay_ToFColor(config->backgroundColor));
                 }
             } break;
             case CLAY_RENDER_COMMAND_TYPE_TEXT: {
                 Clay_TextRenderData *config = &rcmd->renderData.text;
-                TTF_Font *font = rendererData->fonts[config->fontId];
-                TTF_SetFontSize(font, config->fontSize);
-                TTF_Text *text = TTF_CreateText(rendererData->textEngine, font, config->stringContents.chars, config->stringContents.length);
-                TTF_SetTextColor(text, config->textColor.r, config->textColor.g, config->textColor.b, config->textColor.a);
-                TTF_DrawRendererText(text, rect.x, rect.y);
-                TTF_DestroyText(text);
+#ifdef C8VM_USE_GLYPH_ATLAS
+                SDL_Clay_RenderBakedText(rendererData, config, rect);
+#else
+                SDL_Clay_FlushBatch(rendererData);
+                TTF_Text *text = SDL_Clay_GetCachedText(rendererData, config);
+                if (text)
+                    TTF_DrawRendererText(text, rect.x, rect.y);
+#endif
             } break;
             case CLAY_RENDER_COMMAND_TYPE_BORDER: {
                 Clay_BorderRenderData *config = &rcmd->renderData.border;
@@ -209,33 +898,32 @@ static void SDL_Clay_RenderClayCommands(Clay_SDL3RendererData *rendererData, Cla
                     .bottomRight = SDL_min(config->cornerRadius.bottomRight, minRadius)
                 };
                 //edges
-                SDL_SetRenderDrawColor(rendererData->renderer, config->color.r, config->color.g, config->color.b, config->color.a);
+                const SDL_FColor color = SDL_Clay_ToFColor(config->color);
                 if (config->width.left > 0) {
                     const float starting_y = rect.y + clampedRadii.topLeft;
                     const float length = rect.h - clampedRadii.topLeft - clampedRadii.bottomLeft;
                     SDL_FRect line = { rect.x - 1, starting_y, config->width.left, length };
-                    SDL_RenderFillRect(rendererData->renderer, &line);
+                    SDL_Clay_BatchRect(rendererData, line, color);
                 }
                 if (config->width.right > 0) {
                     const float starting_x = rect.x + rect.w - (float)config->width.right + 1;
                     const float starting_y = rect.y + clampedRadii.topRight;
                     const float length = rect.h - clampedRadii.topRight - clampedRadii.bottomRight;
                     SDL_FRect line = { starting_x, starting_y, config->width.right, length };
-                    SDL_RenderFillRect(rendererData->renderer, &line);
+                    SDL_Clay_BatchRect(rendererData, line, color);
                 }
                 if (config->width.top > 0) {
                     const float starting_x = rect.x + clampedRadii.topLeft;
                     const float length = rect.w - clampedRadii.topLeft - clampedRadii.topRight;
                     SDL_FRect line = { starting_x, rect.y - 1, length, config->width.top };
-                    SDL_RenderFillRect(rendererData->renderer, &line);
+                    SDL_Clay_BatchRect(rendererData, line, color);
                 }
                 if (config->width.bottom > 0) {
                     const float starting_x = rect.x + clampedRadii.bottomLeft;
                     const float starting_y = rect.y + rect.h - (float)config->width.bottom + 1;
                     const float length = rect.w - clampedRadii.bottomLeft - clampedRadii.bottomRight;
                     SDL_FRect line = { starting_x, starting_y, length, config->width.bottom };
-                    SDL_SetRenderDrawColor(rendererData->renderer, config->color.r, config->color.g, config->color.b, config->color.a);
-                    SDL_RenderFillRect(rendererData->renderer, &line);
+                    SDL_Clay_BatchRect(rendererData, line, color);
                 }
                 //corners
                 if (config->cornerRadius.topLeft > 0) {
@@ -272,14 +960,20 @@ static void SDL_Clay_RenderClayCommands(Clay_SDL3RendererData *rendererData, Cla
                         .w = boundingBox.width,
                         .h = boundingBox.height,
                 };
+                SDL_Clay_FlushBatch(rendererData);
+                if (region)
+                    isClippedOut = !SDL_GetRectIntersection(&currentClippingRectangle, region, &currentClippingRectangle);
                 SDL_SetRenderClipRect(rendererData->renderer, &currentClippingRectangle);
                 break;
             }
             case CLAY_RENDER_COMMAND_TYPE_SCISSOR_END: {
-                SDL_SetRenderClipRect(rendererData->renderer, NULL);
+                SDL_Clay_FlushBatch(rendererData);
+                isClippedOut = false;
+                SDL_SetRenderClipRect(rendererData->renderer, region);
                 break;
             }
             case CLAY_RENDER_COMMAND_TYPE_IMAGE: {
+                SDL_Clay_FlushBatch(rendererData);
                 SDL_Texture *texture = (SDL_Texture *)rcmd->renderData.image.imageData;
                 const SDL_FRect dest = { rect.x, rect.y, rect.w, rect.h };
                 SDL_RenderTexture(rendererData->renderer, texture, NULL, &dest);
@@ -289,4 +983,176 @@ static void SDL_Clay_RenderClayCommands(Clay_SDL3RendererData *rendererData, Cla
                 SDL_Log("Unknown render command type: %d", rcmd->commandType);
         }
     }
+
+    SDL_Clay_FlushBatch(rendererData);
+}
+
+// Adds a region to redraw, merging all regions into one once there are too many to redraw separately.
+static void SDL_Clay_AddLayerRegion(SDL_Rect *regions, int *regionCount, const SDL_Rect region) {
+    if (*regionCount < LAYER_REGION_CAPACITY) {
+        regions[(*regionCount)++] = region;
+        return;
+    }
+
+    SDL_Rect merged = region;
+    for (int i = 0; i < *regionCount; ++i)
+        SDL_GetRectUnion(&merged, &regions[i], &merged);
+    regions[0] = merged;
+    *regionCount = 1;
+}
+
+// Brings the cached UI layer up to date with the first [count] render commands.
+// Commands are matched to the previous frame's by position and element id; only the regions covered by commands
+// whose content changed are redrawn, and any change in the structure of the layout redraws the whole layer.
+// Returns true if the layer can be drawn; otherwise, false.
+static bool SDL_Clay_UpdateLayer(Clay_SDL3RendererData *rendererData, Clay_RenderCommandArray *rcommands, const int32_t count) {
+    int width, height;
+    if (!SDL_GetCurrentRenderOutputSize(rendererData->renderer, &width, &height))
+        return false;
+
+    bool isFullRedraw = rendererData->isLayerInvalid || count != rendererData->layerRecordCount;
+
+    if (!rendererData->layerTexture || rendererData->layerTexture->w != width || rendererData->layerTexture->h != height) {
+        if (rendererData->layerTexture)
+            SDL_DestroyTexture(rendererData->layerTexture);
+
+        rendererData->layerTexture = SDL_CreateTexture(rendererData->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+        if (!rendererData->layerTexture) {
+            SDL_Log("SDL_CreateTexture failed: %s", SDL_GetError());
+            return false;
+        }
+        SDL_SetTextureBlendMode(rendererData->layerTexture, SDL_BLENDMODE_NONE);
+        isFullRedraw = true;
+    }
+
+    if (count > rendererData->layerRecordCapacity) {
+        LayerCommandRecord *records = SDL_realloc(rendererData->layerRecords, count * sizeof(LayerCommandRecord));
+        if (!records)
+            return false;
+        rendererData->layerRecords = records;
+        rendererData->layerRecordCapacity = count;
+    }
+
+    SDL_Rect regions[LAYER_REGION_CAPACITY];
+    int regionCount = 0;
+
+    for (int32_t i = 0; i < count; ++i) {
+        const Clay_RenderCommand *rcmd = Clay_RenderCommandArray_Get(rcommands, i);
+        const LayerCommandRecord record = {
+            .id = rcmd->id,
+            .hash = SDL_Clay_HashCommand(rcmd),
+            .bounds = SDL_Clay_GetCommandBounds(rcmd)
+        };
+
+        LayerCommandRecord *previous = &rendererData->layerRecords[i];
+        if (!isFullRedraw) {
+            if (previous->id != record.id) {
+                isFullRedraw = true;
+            } else if (previous->hash != record.hash) {
+                SDL_Clay_AddLayerRegion(regions, &regionCount, previous->bounds);
+                SDL_Clay_AddLayerRegion(regions, &regionCount, record.bounds);
+            }
+        }
+        *previous = record;
+    }
+    rendererData->layerRecordCount = count;
+
+    if (isFullRedraw) {
+        regions[0] = (SDL_Rect){ 0, 0, width, height };
+        regionCount = 1;
+    }
+
+    if (regionCount == 0)
+        return true;
+
+    SDL_SetRenderTarget(rendererData->renderer, rendererData->layerTexture);
+
+    for (int i = 0; i < regionCount; ++i) {
+        // Clear the region to the window's background colour, then redraw every command that touches it.
+        SDL_SetRenderClipRect(rendererData->renderer, &regions[i]);
+        SDL_SetRenderDrawBlendMode(rendererData->renderer, SDL_BLENDMODE_NONE);
+        SDL_SetRenderDrawColor(rendererData->renderer, 0, 0, 0, 255);
+        const SDL_FRect region = { regions[i].x, regions[i].y, regions[i].w, regions[i].h };
+        SDL_RenderFillRect(rendererData->renderer, &region);
+
+        SDL_Clay_RenderCommandRange(rendererData, rcommands, 0, count, &regions[i]);
+        rendererData->layerRedrawnPixels += (Uint64)regions[i].w * regions[i].h;
+    }
+
+    SDL_SetRenderClipRect(rendererData->renderer, NULL);
+    SDL_SetRenderTarget(rendererData->renderer, NULL);
+
+    rendererData->isLayerInvalid = false;
+    return true;
+}
+
+// Forces the cached UI layer to be redrawn in full, e.g. after the renderer lost the contents of its render targets.
+static void SDL_Clay_InvalidateLayer(Clay_SDL3RendererData *rendererData) {
+    rendererData->isLayerInvalid = true;
+}
+
+static void SDL_Clay_FreeLayer(Clay_SDL3RendererData *rendererData) {
+    if (rendererData->layerTexture)
+        SDL_DestroyTexture(rendererData->layerTexture);
+    SDL_free(rendererData->layerRecords);
+
+    rendererData->layerTexture = nullptr;
+    rendererData->layerRecords = nullptr;
+    rendererData->layerRecordCount = rendererData->layerRecordCapacity = 0;
+}
+
+// Recreates the textures owned by the renderer after they were lost along with the renderer's device.
+// The display and UI layer textures are recreated when next drawn, with every display row uploaded and the layer redrawn in full.
+static bool SDL_Clay_RecreateTextures(Clay_SDL3RendererData *rendererData) {
+    if (rendererData->displayTexture)
+        SDL_DestroyTexture(rendererData->displayTexture);
+    rendererData->displayTexture = nullptr;
+
+    if (rendererData->layerTexture)
+        SDL_DestroyTexture(rendererData->layerTexture);
+    rendererData->layerTexture = nullptr;
+    rendererData->isLayerInvalid = true;
+
+#ifdef C8VM_USE_GLYPH_ATLAS
+    if (rendererData->glyphAtlasTexture)
+        SDL_DestroyTexture(rendererData->glyphAtlasTexture);
+    rendererData->glyphAtlasTexture = nullptr;
+    return SDL_Clay_CreateGlyphAtlasTexture(rendererData);
+#else
+    return true;
+#endif
+}
+
+// Draws the render commands, with the static part of the UI served from a cached layer texture.
+// Everything before the first custom element (the virtual machine's display) is cached; the display and anything
+// drawn after it are rendered directly every frame, as they change far more often than the rest of the UI.
+static void SDL_Clay_RenderClayCommands(Clay_SDL3RendererData *rendererData, Clay_RenderCommandArray *rcommands)
+{
+    ++rendererData->frame;
+
+    // A custom element inside a scissor region moves the split back to where that region starts, so it is clipped correctly.
+    int32_t cachedCount = rcommands->length;
+    int32_t scissorStart = -1;
+    for (int32_t i = 0; i < rcommands->length; ++i) {
+        const Clay_RenderCommandType type = Clay_RenderCommandArray_Get(rcommands, i)->commandType;
+        if (type == CLAY_RENDER_COMMAND_TYPE_SCISSOR_START) {
+            scissorStart = i;
+        } else if (type == CLAY_RENDER_COMMAND_TYPE_SCISSOR_END) {
+            scissorStart = -1;
+        } else if (type == CLAY_RENDER_COMMAND_TYPE_CUSTOM) {
+            cachedCount = scissorStart >= 0 ? scissorStart : i;
+            break;
+        }
+    }
+
+    if (SDL_Clay_UpdateLayer(rendererData, rcommands, cachedCount))
+        SDL_RenderTexture(rendererData->renderer, rendererData->layerTexture, nullptr, nullptr);
+    else
+        SDL_Clay_RenderCommandRange(rendererData, rcommands, 0, cachedCount, nullptr);
+
+    SDL_Clay_RenderCommandRange(rendererData, rcommands, cachedCount, rcommands->length, nullptr);
+
+#ifndef C8VM_USE_GLYPH_ATLAS
+    SDL_Clay_EvictCachedText(rendererData, false);
+#endif
 }
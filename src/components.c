@@ -13,6 +13,9 @@ static const Clay_Color COLOR_TEXTTOOLTIP_BACKGROUND = { 20, 20, 20, 255 };
 void C8Display(const C8DisplayData c8DisplayData)
 {
     CustomElementData *customElementData = RequestAllocationFromArena(c8DisplayData.frameArena, sizeof(CustomElementData));
+    if (!customElementData)
+        return;
+
     customElementData->type = CUSTOM_ELEMENT_TYPE_C8DISPLAY;
     customElementData->virtualMachine = c8DisplayData.virtualMachine;
 
@@ -69,9 +72,11 @@ void TextButton(const TextButtonData textButtonData)
         if (textButtonData.onPressed)
         {
             TextButtonData *userData = RequestAllocationFromArena(textButtonData.frameArena, sizeof(TextButtonData));
-            *userData = textButtonData;
-
-            Clay_OnHover(TextButton_OnHover, (intptr_t)userData);
+            if (userData)
+            {
+                *userData = textButtonData;
+                Clay_OnHover(TextButton_OnHover, (intptr_t)userData);
+            }
         }
     }
 }
@@ -122,9 +127,11 @@ void CheckButton(const CheckButtonData checkButtonData)
             }));
 
         CheckButtonData *userData = RequestAllocationFromArena(checkButtonData.frameArena, sizeof(CheckButtonData));
-        *userData = checkButtonData;
-
-        Clay_OnHover(CheckButton_OnHover, (intptr_t)userData);
+        if (userData)
+        {
+            *userData = checkButtonData;
+            Clay_OnHover(CheckButton_OnHover, (intptr_t)userData);
+        }
     }
 }
 
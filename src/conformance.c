@@ -0,0 +1,164 @@
+#include <stdatomic.h>
+
+#include "conformance.h"
+#include "random.h"
+#include "search.h"
+
+typedef struct
+{
+	const C8_Instance *initials;
+	const C8_ConformanceOptions *options;
+	C8_ConformanceResult *results;
+	atomic_bool hasFailed;
+} ConformanceJob;
+
+uint32_t C8_RunReferenceCycles(C8_Instance *instance, const uint32_t cycleCount)
+{
+	const uint16_t cyclesPerTimerTick = instance->config.cyclesPerTimerTick;
+	const uint64_t firstCycle = instance->cycleCount;
+
+	for (uint32_t i = 0; i < cycleCount && instance->status == C8_STATUS_RUNNING; ++i)
+	{
+		const uint64_t previousCycle = instance->cycleCount;
+		C8_FetchExecute(instance);
+
+		// A fetch that halts execution doesn't count as a cycle, so it mustn't tick the timers either.
+		if (cyclesPerTimerTick && instance->cycleCount != previousCycle && instance->cycleCount % cyclesPerTimerTick == 0)
+			C8_UpdateTimers(instance);
+	}
+
+	return (uint32_t)(instance->cycleCount - firstCycle);
+}
+
+// Chooses the action held during an interval, scrambling its index so that consecutive intervals are uncorrelated.
+static uint8_t ChooseAction(const uint32_t seed, const uint64_t interval)
+{
+	return (uint8_t)(C8_MixSeed(seed, interval) % C8_SEARCH_ACTION_COUNT);
+}
+
+static bool IsSameState(const C8_Instance *reference, const C8_Instance *candidate)
+{
+	return reference->cycleCount == candidate->cycleCount && C8_GetStateHash(reference) == C8_GetStateHash(candidate);
+}
+
+// Forks the checkpoint into both scratch instances and executes [cycleCount] cycles with each engine.
+static bool RunFromCheckpoint(const C8_Instance *checkpoint, const uint32_t cycleCount, const C8_Engine engine, C8_Instance *reference, C8_Instance *candidate)
+{
+	if (!C8_Fork(reference, checkpoint) || !C8_Fork(candidate, checkpoint))
+		return false;
+
+	C8_RunReferenceCycles(reference, cycleCount);
+	engine(candidate, cycleCount);
+	return true;
+}
+
+// Narrows an interval whose end states differed down to the first cycle after which they differ, and records the
+// instruction executed in that cycle along with the states it left behind.
+static bool BisectDivergence(const C8_Instance *checkpoint, const uint32_t length, const C8_Engine engine, C8_Instance *reference, C8_Instance *candidate, C8_ConformanceResult *result)
+{
+	// The states match after [matching] cycles and differ after [differing].
+	uint32_t matching = 0;
+	uint32_t differing = length;
+	while (differing - matching > 1)
+	{
+		const uint32_t middle = matching + (differing - matching) / 2;
+		if (!RunFromCheckpoint(checkpoint, middle, engine, reference, candidate))
+			return false;
+
+		if (IsSameState(reference, candidate))
+			matching = middle;
+		else
+			differing = middle;
+	}
+
+	if (!RunFromCheckpoint(checkpoint, matching, engine, reference, candidate))
+		return false;
+
+	result->pc = reference->pc;
+	result->opcode = (uint16_t)(C8_ReadHeap(reference, reference->pc) << 8 | C8_ReadHeap(reference, reference->pc + 1));
+	result->cycleCount += matching;
+
+	C8_RunReferenceCycles(reference, differing - matching);
+	engine(candidate, differing - matching);
+
+	return C8_Fork(&result->reference, reference) && C8_Fork(&result->candidate, candidate);
+}
+
+static bool CheckInitialState(const C8_Instance *initial, const C8_ConformanceOptions *options, C8_ConformanceResult *result)
+{
+	C8_Instance checkpoint = { 0 };
+	C8_Instance reference = { 0 };
+	C8_Instance candidate = { 0 };
+	bool isSuccessful = C8_Fork(&checkpoint, initial);
+
+	uint64_t interval = 0;
+	for (uint64_t executed = 0; isSuccessful && executed < options->cycleCount; executed += options->checkInterval, ++interval)
+	{
+		const uint64_t remaining = options->cycleCount - executed;
+		const uint32_t length = remaining < options->checkInterval ? (uint32_t)remaining : options->checkInterval;
+
+		// Keys are changed at checkpoints only, so that any part of an interval can be replayed from its checkpoint.
+		C8_ApplyAction(&checkpoint, ChooseAction(options->inputSeed, interval));
+
+		isSuccessful = RunFromCheckpoint(&checkpoint, length, options->engine, &reference, &candidate);
+		if (!isSuccessful)
+			break;
+
+		if (!IsSameState(&reference, &candidate))
+		{
+			result->hasDiverged = true;
+			result->cycleCount = checkpoint.cycleCount - initial->cycleCount;
+			isSuccessful = BisectDivergence(&checkpoint, length, options->engine, &reference, &candidate, result);
+			break;
+		}
+
+		isSuccessful = C8_Fork(&checkpoint, &reference);
+
+		// Both halted in the same state, so neither can execute anything further.
+		if (reference.status != C8_STATUS_RUNNING)
+			break;
+	}
+
+	if (!result->hasDiverged)
+		result->cycleCount = checkpoint.cycleCount - initial->cycleCount;
+
+	C8_Reset(&checkpoint);
+	C8_Reset(&reference);
+	C8_Reset(&candidate);
+
+	return isSuccessful;
+}
+
+static void CheckConformanceJob(void *userData, const size_t index)
+{
+	ConformanceJob *job = userData;
+
+	job->results[index] = (C8_ConformanceResult){ 0 };
+	if (!CheckInitialState(&job->initials[index], job->options, &job->results[index]))
+		atomic_store(&job->hasFailed, true);
+}
+
+bool C8_CheckConformance(const C8_Instance *initials, const size_t count, const C8_ConformanceOptions options, JobPool *pool, C8_ConformanceResult *results)
+{
+	ConformanceJob job = {
+		.initials = initials,
+		.options = &options,
+		.results = results
+	};
+	atomic_init(&job.hasFailed, false);
+
+	if (options.checkInterval == 0)
+		return false;
+
+	RunJobsOnPool(pool, count, CheckConformanceJob, &job);
+	return !atomic_load(&job.hasFailed);
+}
+
+void C8_FreeConformanceResults(C8_ConformanceResult *results, const size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		C8_Reset(&results[i].reference);
+		C8_Reset(&results[i].candidate);
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef C8_CONFORMANCE_H
+#define C8_CONFORMANCE_H
+
+#include <stdint.h>
+
+#include "jobs.h"
+#include "vm.h"
+
+// Executes up to [cycleCount] fetch-execute cycles, stopping early if execution halts, and updates the timers whenever
+// the cycle count reaches a multiple of the configuration's cyclesPerTimerTick, as C8_RunCycles does.
+// An engine must reach the same state however a run is split into calls.
+// Returns the number of cycles performed.
+typedef uint32_t (*C8_Engine)(C8_Instance *instance, uint32_t cycleCount);
+
+// Controls how an engine is checked against the reference.
+typedef struct
+{
+	// The engine to check.
+	C8_Engine engine;
+
+	// The number of cycles to execute from each initial state.
+	uint32_t cycleCount;
+
+	// The number of cycles between comparisons of the two states. A different key is held for each interval.
+	uint32_t checkInterval;
+
+	// Seeds the sequence of keys held, which is the same for every initial state.
+	uint32_t inputSeed;
+} C8_ConformanceOptions;
+
+// The outcome of checking an engine from a single initial state.
+typedef struct
+{
+	// True if the engine's state ever differed from the reference's.
+	bool hasDiverged;
+
+	// The number of cycles executed by both before their states first differed, not counting the instruction that made
+	// them differ, or by the reference if they never did.
+	uint64_t cycleCount;
+
+	// The address and opcode of the instruction after which the states first differed.
+	uint16_t pc;
+	uint16_t opcode;
+
+	// If the run diverged, the states of the reference and the engine just after that instruction; otherwise, empty.
+	C8_Instance reference;
+	C8_Instance candidate;
+} C8_ConformanceResult;
+
+// Executes one fetch-execute cycle at a time with C8_FetchExecute, updating the timers in between.
+// This is the reference every other engine is checked against.
+uint32_t C8_RunReferenceCycles(C8_Instance *instance, uint32_t cycleCount);
+
+// Executes each initial state with both the reference and [options.engine] in parallel on the [pool], feeding both the
+// same keys, and compares their state hashes and cycle counts every [options.checkInterval] cycles.
+// On the first difference, the interval is bisected down to the instruction after which the states first differed.
+// The initial states are not modified. Free the results with C8_FreeConformanceResults.
+// Returns true if every initial state was checked; otherwise, false if memory could not be allocated.
+bool C8_CheckConformance(const C8_Instance *initials, size_t count, C8_ConformanceOptions options, JobPool *pool, C8_ConformanceResult *results);
+
+// Frees the states held by the results.
+void C8_FreeConformanceResults(C8_ConformanceResult *results, size_t count);
+
+#endif // C8_CONFORMANCE_H
@@ -0,0 +1,535 @@
+#include <errno.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <SDL3/SDL.h>
+
+#include "analyzer.h"
+#include "control.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+// A request taken from a client's input.
+typedef struct
+{
+    uint8_t command;
+    uint16_t tag;
+    const uint8_t *payload;
+    uint32_t payloadSize;
+} ControlRequest;
+
+static uint16_t ReadUint16(const uint8_t *bytes)
+{
+    return (uint16_t)(bytes[0] | bytes[1] << 8);
+}
+
+static uint32_t ReadUint32(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+// Grows the [client]'s output buffer to fit [size] more bytes. Returns a pointer to them, or a null pointer if memory ran out.
+static uint8_t *ReserveOutput(ControlClient *client, const size_t size)
+{
+    if (client->outputSize + size > client->outputCapacity)
+    {
+        size_t capacity = client->outputCapacity ? client->outputCapacity * 2 : 4096;
+        while (capacity < client->outputSize + size)
+            capacity *= 2;
+
+        uint8_t *output = SDL_realloc(client->output, capacity);
+        if (!output)
+            return nullptr;
+
+        client->output = output;
+        client->outputCapacity = capacity;
+    }
+
+    uint8_t *reserved = client->output + client->outputSize;
+    client->outputSize += size;
+    return reserved;
+}
+
+static void WriteUint16(uint8_t *bytes, const uint16_t value)
+{
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+}
+
+static void WriteUint32(uint8_t *bytes, const uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        bytes[i] = (uint8_t)(value >> 8 * i);
+}
+
+static void WriteUint64(uint8_t *bytes, const uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+        bytes[i] = (uint8_t)(value >> 8 * i);
+}
+
+// Appends a response header to the [client]'s output, followed by room for [payloadSize] bytes of payload.
+// Returns a pointer to the payload, or a null pointer if memory ran out.
+static uint8_t *BeginResponse(ControlClient *client, const ControlRequest *request, const ControlStatus status, const uint32_t payloadSize)
+{
+    uint8_t *header = ReserveOutput(client, CONTROL_HEADER_SIZE + payloadSize);
+    if (!header)
+        return nullptr;
+
+    header[0] = request->command;
+    header[1] = (uint8_t)status;
+    WriteUint16(header + 2, request->tag);
+    WriteUint32(header + 4, payloadSize);
+    return header + CONTROL_HEADER_SIZE;
+}
+
+static bool LoadProgram(C8VM *virtualMachine, const uint8_t *pathBytes, const uint32_t pathSize)
+{
+    char path[CONTROL_MAX_PAYLOAD_SIZE + 1];
+    memcpy(path, pathBytes, pathSize);
+    path[pathSize] = '\0';
+
+    // Start from a clean state, so that nothing is carried over from the previous program, including a replay.
+    virtualMachine->isReplayingMovie = false;
+    C8_Reset(&virtualMachine->instance);
+    virtualMachine->instance.config = virtualMachine->config;
+
+    char *error;
+    if (!virtualMachine->autoDetectQuirks)
+    {
+        if (!C8_LoadProgram(&virtualMachine->instance, path, &error))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "C8_LoadProgram failed: %s\n", error);
+            return false;
+        }
+    }
+    else
+    {
+        // Only the static analyzer is consulted, as detecting quirks dynamically would stall the frame.
+        C8_Analysis analysis;
+        if (!C8_LoadProgramFileDetected(&virtualMachine->instance, path, &analysis, &error))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "C8_LoadProgramFileDetected failed: %s\n", error);
+            return false;
+        }
+    }
+
+    if (virtualMachine->isRecordingMovie)
+        C8_BeginMovie(&virtualMachine->movie, &virtualMachine->instance);
+
+    if (virtualMachine->programPath)
+        SDL_free(virtualMachine->programPath);
+    virtualMachine->programPath = SDL_strdup(path);
+    return true;
+}
+
+static void StepFrames(C8VM *virtualMachine, const uint32_t frameCount)
+{
+    const uint16_t cyclesPerFrame = SDL_max(virtualMachine->cyclesPerSecond / 60, 1);
+
+    for (uint32_t frame = 0; frame < frameCount && virtualMachine->instance.status == C8_STATUS_RUNNING; ++frame)
+    {
+        C8_RunCycles(&virtualMachine->instance, cyclesPerFrame);
+        if (!virtualMachine->instance.config.cyclesPerTimerTick)
+            C8_UpdateTimers(&virtualMachine->instance);
+
+        if (virtualMachine->isRecordingMovie && !C8_RecordFrame(&virtualMachine->movie, &virtualMachine->instance))
+            virtualMachine->isRecordingMovie = false;
+    }
+}
+
+// Executes a request and appends its response to the [client]'s output.
+// Returns a bitmask of ControlEvent values, or -1 if memory for the response ran out.
+static int ExecuteRequest(ControlServer *server, ControlClient *client, C8VM *virtualMachine, const ControlRequest *request)
+{
+    C8_Instance *instance = &virtualMachine->instance;
+    const bool isLoaded = instance->heapPages != nullptr;
+
+    // Keys and frames can't be driven while a movie replay drives them, or the replay would diverge.
+    const bool isDrivable = isLoaded && !virtualMachine->isReplayingMovie;
+    const uint8_t *payload = request->payload;
+    ControlStatus status = CONTROL_STATUS_OK;
+    int events = 0;
+
+    switch (request->command)
+    {
+        case CONTROL_COMMAND_PING:
+            break;
+        case CONTROL_COMMAND_LOAD_PROGRAM:
+            if (request->payloadSize == 0)
+                status = CONTROL_STATUS_BAD_REQUEST;
+            else if (!LoadProgram(virtualMachine, payload, request->payloadSize))
+                status = CONTROL_STATUS_FAILED;
+            else
+                events |= CONTROL_EVENT_PROGRAM_LOADED;
+            break;
+        case CONTROL_COMMAND_SET_KEYS:
+            if (request->payloadSize != 2 || !isDrivable)
+            {
+                status = isDrivable ? CONTROL_STATUS_BAD_REQUEST : CONTROL_STATUS_FAILED;
+                break;
+            }
+            for (uint8_t key = 0; key < 16; ++key)
+            {
+                const bool isPressed = ReadUint16(payload) >> key & 1;
+                if (instance->keysPressed[key] == isPressed)
+                    continue;
+
+                if (virtualMachine->isRecordingMovie && !C8_RecordKeyEvent(&virtualMachine->movie, instance, key, isPressed))
+                    virtualMachine->isRecordingMovie = false;
+                C8_NotifyKeyEvent(instance, key, isPressed);
+            }
+            break;
+        case CONTROL_COMMAND_STEP_FRAMES:
+            if (request->payloadSize != 4 || !isDrivable)
+                status = isDrivable ? CONTROL_STATUS_BAD_REQUEST : CONTROL_STATUS_FAILED;
+            else if (ReadUint32(payload) > CONTROL_MAX_STEP_FRAMES)
+                status = CONTROL_STATUS_BAD_REQUEST;
+            else
+                StepFrames(virtualMachine, ReadUint32(payload));
+            break;
+        case CONTROL_COMMAND_READ_MEMORY:
+        {
+            if (request->payloadSize != 6 || !isLoaded)
+            {
+                status = isLoaded ? CONTROL_STATUS_BAD_REQUEST : CONTROL_STATUS_FAILED;
+                break;
+            }
+
+            const uint32_t address = ReadUint32(payload);
+            const uint16_t length = ReadUint16(payload + 4);
+            uint8_t *response = BeginResponse(client, request, status, length);
+            if (!response)
+                return -1;
+            for (uint16_t i = 0; i < length; ++i)
+                response[i] = C8_ReadHeap(instance, address + i);
+            return events;
+        }
+        case CONTROL_COMMAND_READ_REGISTERS:
+        {
+            constexpr uint32_t size = 16 + 3 * 2 + 3 + CHIP_8_STACK_DEPTH * 2;
+            uint8_t *response = BeginResponse(client, request, status, size);
+            if (!response)
+                return -1;
+
+            memcpy(response, instance->v, 16);
+            WriteUint16(response + 16, instance->i);
+            WriteUint16(response + 18, instance->pc);
+            WriteUint16(response + 20, instance->sp);
+            response[22] = instance->dt;
+            response[23] = instance->st;
+            response[24] = (uint8_t)instance->status;
+            for (int i = 0; i < CHIP_8_STACK_DEPTH; ++i)
+                WriteUint16(response + 25 + i * 2, instance->stack[i]);
+            return events;
+        }
+        case CONTROL_COMMAND_READ_FRAMEBUFFER:
+        {
+            if (!isLoaded)
+            {
+                status = CONTROL_STATUS_FAILED;
+                break;
+            }
+
+            const size_t wordCount = C8_GetFramebufferSize(instance) / sizeof(uint64_t);
+            uint8_t *response = BeginResponse(client, request, status, (uint32_t)(4 + wordCount * sizeof(uint64_t)));
+            if (!response)
+                return -1;
+
+            response[0] = C8_GetDisplayWidth(instance);
+            response[1] = C8_GetDisplayHeight(instance);
+            response[2] = instance->displayRowWords;
+            response[3] = instance->planeCount;
+            for (size_t word = 0; word < wordCount; ++word)
+                WriteUint64(response + 4 + word * sizeof(uint64_t), instance->framebuffer[word]);
+            return events;
+        }
+        case CONTROL_COMMAND_SAVE_STATE:
+        case CONTROL_COMMAND_LOAD_STATE:
+        {
+            if (request->payloadSize != 1 || payload[0] >= CONTROL_STATE_SLOTS)
+            {
+                status = CONTROL_STATUS_BAD_REQUEST;
+                break;
+            }
+
+            // Saved states share heap pages with the instance, copy-on-write, so saving and loading are cheap.
+            C8_Instance *slot = &server->savedStates[payload[0]];
+            if (request->command == CONTROL_COMMAND_SAVE_STATE)
+            {
+                if (!isLoaded || !C8_Fork(slot, instance))
+                    status = CONTROL_STATUS_FAILED;
+            }
+            else
+            {
+                // A movie replays from the moment its program was loaded, so it can't record or replay across a jump to
+                // another state.
+                const uint32_t displayGeneration = instance->displayGeneration;
+                if (virtualMachine->isRecordingMovie || virtualMachine->isReplayingMovie || !slot->heapPages || !C8_Fork(instance, slot))
+                    status = CONTROL_STATUS_FAILED;
+                else
+                    C8_InvalidateDisplay(instance, displayGeneration);
+            }
+            break;
+        }
+        case CONTROL_COMMAND_SET_RUNNING:
+            if (request->payloadSize != 1)
+                status = CONTROL_STATUS_BAD_REQUEST;
+            else if (payload[0] && !isLoaded)
+                status = CONTROL_STATUS_FAILED;
+            else
+                virtualMachine->isRunning = payload[0] != 0;
+            break;
+        case CONTROL_COMMAND_QUIT:
+            events |= CONTROL_EVENT_QUIT_REQUESTED;
+            break;
+        default:
+            status = CONTROL_STATUS_UNKNOWN_COMMAND;
+            break;
+    }
+
+    return BeginResponse(client, request, status, 0) ? events : -1;
+}
+
+static void DisconnectClient(ControlServer *server, const int index)
+{
+    ControlClient *client = &server->clients[index];
+    close(client->socket);
+    SDL_free(client->output);
+
+    server->clients[index] = server->clients[--server->clientCount];
+}
+
+static bool SetNonBlocking(const int socket)
+{
+    const int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static void AcceptClients(ControlServer *server)
+{
+    while (server->clientCount < CONTROL_MAX_CLIENTS)
+    {
+        const int socket = accept(server->listener, nullptr, nullptr);
+        if (socket < 0)
+            return;
+
+        if (!SetNonBlocking(socket))
+        {
+            close(socket);
+            continue;
+        }
+
+        server->clients[server->clientCount++] = (ControlClient){ .socket = socket };
+    }
+}
+
+// Sends as much of the [client]'s pending output as the socket accepts. Returns false if the client disconnected.
+static bool FlushOutput(ControlClient *client)
+{
+    size_t sent = 0;
+    while (sent < client->outputSize)
+    {
+        const ssize_t result = send(client->socket, client->output + sent, client->outputSize - sent, SEND_FLAGS);
+        if (result < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        sent += (size_t)result;
+    }
+
+    if (sent > 0)
+    {
+        memmove(client->output, client->output + sent, client->outputSize - sent);
+        client->outputSize -= sent;
+    }
+    return true;
+}
+
+// Reads and executes every complete request from the [client]. Returns a bitmask of ControlEvent values, or -1 if the
+// client disconnected or broke the protocol.
+static int ServeClient(ControlServer *server, ControlClient *client, C8VM *virtualMachine)
+{
+    int events = 0;
+
+    // Requests are executed as they are read, so each batch is answered by the time the client's next read arrives.
+    while (client->outputSize < CONTROL_OUTPUT_LIMIT)
+    {
+        const ssize_t received = recv(client->socket, client->input + client->inputSize, sizeof(client->input) - client->inputSize, 0);
+        if (received == 0)
+            return -1;
+        if (received < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return -1;
+        }
+        client->inputSize += (size_t)received;
+
+        size_t offset = 0;
+        while (client->inputSize - offset >= CONTROL_HEADER_SIZE)
+        {
+            const uint8_t *header = client->input + offset;
+            const uint32_t payloadSize = ReadUint32(header + 4);
+
+            // Requests too large to buffer can't be skipped reliably, so the connection is dropped.
+            if (payloadSize > CONTROL_MAX_PAYLOAD_SIZE)
+                return -1;
+            if (client->inputSize - offset < CONTROL_HEADER_SIZE + payloadSize)
+                break;
+
+            const ControlRequest request = {
+                .command = header[0],
+                .tag = ReadUint16(header + 2),
+                .payload = header + CONTROL_HEADER_SIZE,
+                .payloadSize = payloadSize
+            };
+
+            const int requestEvents = ExecuteRequest(server, client, virtualMachine, &request);
+            if (requestEvents < 0)
+                return -1;
+            events |= requestEvents;
+            offset += CONTROL_HEADER_SIZE + payloadSize;
+        }
+
+        memmove(client->input, client->input + offset, client->inputSize - offset);
+        client->inputSize -= offset;
+    }
+
+    return FlushOutput(client) ? events : -1;
+}
+
+bool CreateControlServer(ControlServer *server, const char *path)
+{
+    *server = (ControlServer){ 0 };
+
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (SDL_strlcpy(address.sun_path, path, sizeof(address.sun_path)) >= sizeof(address.sun_path))
+        return SDL_SetError("Control socket path '%s' is too long", path);
+    SDL_strlcpy(server->path, path, sizeof(server->path));
+
+    server->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server->listener < 0)
+        return SDL_SetError("socket failed: %s", strerror(errno));
+
+    // A socket left behind by a previous run that didn't exit cleanly would make binding fail.
+    unlink(path);
+
+    if (bind(server->listener, (struct sockaddr *)&address, sizeof(address)) != 0
+        || listen(server->listener, CONTROL_MAX_CLIENTS) != 0
+        || !SetNonBlocking(server->listener))
+    {
+        const int error = errno;
+        close(server->listener);
+        return SDL_SetError("Failed to listen on '%s': %s", path, strerror(error));
+    }
+
+    server->isListening = true;
+    return true;
+}
+
+int PollControlServer(ControlServer *server, C8VM *virtualMachine)
+{
+    if (!server->isListening)
+        return 0;
+
+    AcceptClients(server);
+
+    int events = 0;
+    for (int i = 0; i < server->clientCount;)
+    {
+        const int clientEvents = ServeClient(server, &server->clients[i], virtualMachine);
+        if (clientEvents < 0)
+        {
+            DisconnectClient(server, i);
+            continue;
+        }
+
+        events |= clientEvents;
+        ++i;
+    }
+
+    return events;
+}
+
+void WaitForControlServer(const ControlServer *server, const int timeoutMilliseconds)
+{
+    if (!server->isListening)
+        return;
+
+    struct pollfd descriptors[1 + CONTROL_MAX_CLIENTS];
+    descriptors[0] = (struct pollfd){ .fd = server->listener, .events = POLLIN };
+    for (int i = 0; i < server->clientCount; ++i)
+    {
+        // Clients with responses backed up are woken once they can be written to again.
+        const bool isBackedUp = server->clients[i].outputSize > 0;
+        descriptors[1 + i] = (struct pollfd){ .fd = server->clients[i].socket, .events = isBackedUp ? POLLIN | POLLOUT : POLLIN };
+    }
+
+    poll(descriptors, 1 + server->clientCount, timeoutMilliseconds);
+}
+
+void FreeControlServer(ControlServer *server)
+{
+    while (server->clientCount > 0)
+        DisconnectClient(server, server->clientCount - 1);
+
+    if (server->isListening)
+    {
+        close(server->listener);
+        unlink(server->path);
+    }
+
+    for (int i = 0; i < CONTROL_STATE_SLOTS; ++i)
+        C8_Reset(&server->savedStates[i]);
+
+    *server = (ControlServer){ 0 };
+}
+
+#else
+
+bool CreateControlServer(ControlServer *server, const char *path)
+{
+    (void)path;
+    *server = (ControlServer){ 0 };
+    return SDL_SetError("Control sockets are not supported on this platform");
+}
+
+int PollControlServer(ControlServer *server, C8VM *virtualMachine)
+{
+    (void)server;
+    (void)virtualMachine;
+    return 0;
+}
+
+void WaitForControlServer(const ControlServer *server, const int timeoutMilliseconds)
+{
+    (void)server;
+    (void)timeoutMilliseconds;
+}
+
+void FreeControlServer(ControlServer *server)
+{
+    *server = (ControlServer){ 0 };
+}
+
+#endif
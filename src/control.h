@@ -0,0 +1,137 @@
+#ifndef C8VM_CONTROL_H
+#define C8VM_CONTROL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core.h"
+#include "vm.h"
+
+// The maximum number of scripts that can be connected at once.
+#define CONTROL_MAX_CLIENTS 8
+
+// The number of slots that states can be saved to and loaded from.
+#define CONTROL_STATE_SLOTS 8
+
+// The size (in bytes) of the header preceding every request and response.
+#define CONTROL_HEADER_SIZE 8
+
+// The maximum size (in bytes) of a request's payload.
+#define CONTROL_MAX_PAYLOAD_SIZE 4096
+
+// The maximum number of frames a single STEP_FRAMES request can execute: a minute at 60 frames per second.
+// Requests are executed between the application's frames, so larger counts would stall it; send several instead.
+#define CONTROL_MAX_STEP_FRAMES 3600
+
+// Requests stop being read from a client while this many bytes of its responses are waiting to be sent.
+#define CONTROL_OUTPUT_LIMIT (1024 * 1024)
+
+// The commands a request can carry. Every request and response starts with an 8-byte header:
+//   uint8 command, uint8 status (zero in requests), uint16 tag (echoed back in the response), uint32 payload size,
+// followed by the payload. Multi-byte values are little-endian.
+// Clients may send any number of requests without waiting; they are executed in order at the next frame boundary and
+// answered in the same order, so a batch such as STEP_FRAMES followed by READ_FRAMEBUFFER takes a single round trip.
+typedef enum
+{
+    // Request: empty. Response: empty.
+    CONTROL_COMMAND_PING,
+
+    // Request: the program's path, without a terminator. Response: empty. Ends any movie being replayed.
+    CONTROL_COMMAND_LOAD_PROGRAM,
+
+    // Request: uint16 bitmask of the keys to hold, with bit (n) for key (n); other keys are released. Response: empty,
+    // or CONTROL_STATUS_FAILED while a movie is being replayed.
+    CONTROL_COMMAND_SET_KEYS,
+
+    // Request: uint32 number of frames to execute, up to CONTROL_MAX_STEP_FRAMES. Response: empty, or
+    // CONTROL_STATUS_FAILED while a movie is being replayed.
+    CONTROL_COMMAND_STEP_FRAMES,
+
+    // Request: uint32 address, uint16 length. Response: [length] bytes of heap memory, wrapped to the bounds of the heap.
+    CONTROL_COMMAND_READ_MEMORY,
+
+    // Request: empty. Response: V0-VF, uint16 I, uint16 PC, uint16 SP, uint8 DT, uint8 ST, uint8 status, then the stack
+    // as CHIP_8_STACK_DEPTH uint16 entries.
+    CONTROL_COMMAND_READ_REGISTERS,
+
+    // Request: empty. Response: uint8 display width, uint8 display height, uint8 words per row, uint8 bitplane count,
+    // then the framebuffer as uint64 words, laid out as described by C8_Instance.framebuffer.
+    CONTROL_COMMAND_READ_FRAMEBUFFER,
+
+    // Request: uint8 slot. Response: empty.
+    CONTROL_COMMAND_SAVE_STATE,
+
+    // Request: uint8 slot. Response: empty, or CONTROL_STATUS_FAILED if nothing was saved to the slot or a movie is
+    // being recorded or replayed.
+    CONTROL_COMMAND_LOAD_STATE,
+
+    // Request: uint8, non-zero to run the program in real time between frames, or zero to pause it. Response: empty.
+    CONTROL_COMMAND_SET_RUNNING,
+
+    // Request: empty. Response: empty, after which the application exits.
+    CONTROL_COMMAND_QUIT
+} ControlCommand;
+
+typedef enum
+{
+    CONTROL_STATUS_OK,
+    CONTROL_STATUS_UNKNOWN_COMMAND,
+
+    // The payload was the wrong size or held an invalid value.
+    CONTROL_STATUS_BAD_REQUEST,
+
+    // The command was valid but could not be carried out, e.g. the program failed to load.
+    CONTROL_STATUS_FAILED
+} ControlStatus;
+
+// Describes what happened while polling that the application must react to.
+typedef enum
+{
+    CONTROL_EVENT_PROGRAM_LOADED = 1 << 0,
+    CONTROL_EVENT_QUIT_REQUESTED = 1 << 1
+} ControlEvent;
+
+// A connected script, with the requests it has sent that are yet to be executed and the responses yet to be sent.
+typedef struct
+{
+    int socket;
+
+    uint8_t input[CONTROL_HEADER_SIZE + CONTROL_MAX_PAYLOAD_SIZE];
+    size_t inputSize;
+
+    uint8_t *output;
+    size_t outputSize;
+    size_t outputCapacity;
+} ControlClient;
+
+// A UNIX-domain socket that scripts connect to in order to drive the virtual machine.
+typedef struct
+{
+    // False until the socket is listening, so that a zeroed server can be polled and freed harmlessly.
+    bool isListening;
+    int listener;
+    char path[108];
+
+    ControlClient clients[CONTROL_MAX_CLIENTS];
+    int clientCount;
+
+    C8_Instance savedStates[CONTROL_STATE_SLOTS];
+} ControlServer;
+
+// Creates a UNIX-domain socket at [path] and starts listening for scripts, replacing any stale socket left at [path].
+// Returns true if the socket was created; otherwise, false, with the reason available from SDL_GetError.
+// Not supported on platforms without UNIX-domain sockets.
+bool CreateControlServer(ControlServer *server, const char *path);
+
+// Accepts new connections, executes every complete request received since the last poll against the [virtualMachine]
+// and sends back their responses, without blocking. Call once per frame, at a frame boundary.
+// Returns a bitmask of ControlEvent values.
+int PollControlServer(ControlServer *server, C8VM *virtualMachine);
+
+// Blocks until a script connects or sends data, or [timeoutMilliseconds] elapse; a negative timeout waits indefinitely.
+void WaitForControlServer(const ControlServer *server, int timeoutMilliseconds);
+
+// Disconnects every script, removes the socket, and frees the memory held by the [server].
+void FreeControlServer(ControlServer *server);
+
+#endif // C8VM_CONTROL_H
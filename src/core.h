@@ -3,21 +3,36 @@
 
 #include <stdint.h>
 
+#include "movie.h"
 #include "vm.h"
 
 typedef struct
 {
     bool isRunning;
+    bool autoDetectQuirks;
     char *programPath;
     uint16_t cyclesPerSecond;
+
+    // The configuration chosen on the Settings screen. Each program is loaded with it, or, if autoDetectQuirks is set,
+    // analysed from it, so the instance's configuration never carries over from the previous program.
+    C8_Config config;
     C8_Instance instance;
+
+    // If true, key events and frames are recorded to the movie, which restarts whenever a program is loaded.
+    bool isRecordingMovie;
+    C8_Movie movie;
+
+    // If true, a movie replayed with --replay drives execution in place of the clock and keyboard.
+    // Cleared whenever the program is loaded, restarted or exited, as the movie no longer matches its state.
+    bool isReplayingMovie;
 } C8VM;
 
 typedef enum
 {
     FONT_PIXELOID_SANS_16PT,
     FONT_PIXELOID_SANS_BOLD_32PT,
-    FONT_PIXELOID_SANS_BOLD_48PT
+    FONT_PIXELOID_SANS_BOLD_48PT,
+    FONT_COUNT
 } Font;
 
 typedef enum
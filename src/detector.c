@@ -0,0 +1,135 @@
+#include <string.h>
+
+#include "detector.h"
+
+// The rate at which frames are simulated, matching the rate of the delay and sound timers.
+#define FRAMES_PER_SECOND 60
+
+// The number of frames between simulated key presses, allowing programs to progress past prompts.
+#define KEY_PRESS_INTERVAL 30
+
+// The number of frames each simulated key press is held for.
+#define KEY_PRESS_DURATION 6
+
+typedef struct
+{
+	const C8_Instance *instance;
+	C8_DetectionOptions options;
+	C8_QuirkDetection *detection;
+} DetectionJob;
+
+static C8_Config ConfigFromCombination(C8_Config config, const size_t combination)
+{
+	config.useParameterisedShift = combination & 0x1;
+	config.useParameterisedJump = combination & 0x2;
+	config.useTemporaryIndex = combination & 0x4;
+	return config;
+}
+
+static int QuirkDistance(const C8_Config a, const C8_Config b)
+{
+	return (a.useParameterisedShift != b.useParameterisedShift)
+		+ (a.useParameterisedJump != b.useParameterisedJump)
+		+ (a.useTemporaryIndex != b.useTemporaryIndex);
+}
+
+static bool IsInProgram(const C8_Instance *instance)
+{
+	return instance->pc >= PROGRAM_OFFSET && instance->pc < PROGRAM_OFFSET + instance->programSize;
+}
+
+// Returns true if the instruction at the program counter jumps to itself, which programs use to halt.
+static bool IsSelfJump(const C8_Instance *instance)
+{
+	const uint16_t inst = C8_ReadHeap(instance, instance->pc) << 8 | C8_ReadHeap(instance, instance->pc + 1);
+	return inst >> 12 == 0x1 && (inst & 0x0FFF) == instance->pc;
+}
+
+static void ExecuteDetectionRun(void *userData, const size_t combination)
+{
+	const DetectionJob *job = userData;
+	C8_DetectionRun *run = &job->detection->runs[combination];
+
+	const uint32_t frameCount = job->options.seconds * FRAMES_PER_SECOND;
+	const uint32_t cyclesPerFrame = SDL_max(job->options.cyclesPerSecond / FRAMES_PER_SECOND, 1);
+
+	*run = (C8_DetectionRun){
+		.config = ConfigFromCombination(job->instance->config, combination)
+	};
+
+	// A run that cannot be started is treated as though it crashed immediately.
+	C8_Instance instance;
+	if (!C8_CopyInstance(&instance, job->instance))
+	{
+		run->hasCrashed = true;
+		run->score = -4 * (int32_t)frameCount;
+		return;
+	}
+	instance.config = run->config;
+
+	const size_t framebufferSize = C8_GetFramebufferSize(&instance);
+	uint64_t previousFramebuffer[C8_FRAMEBUFFER_MAX_WORDS];
+	memcpy(previousFramebuffer, instance.framebuffer, framebufferSize);
+	uint32_t previousGeneration = instance.displayGeneration;
+
+	for (uint32_t frame = 0; frame < frameCount && !run->hasCrashed && instance.status != C8_STATUS_EXITED; ++frame)
+	{
+		const uint32_t keyPhase = frame % KEY_PRESS_INTERVAL;
+		if (keyPhase == 0 || keyPhase == KEY_PRESS_DURATION)
+			C8_NotifyKeyEvent(&instance, frame / KEY_PRESS_INTERVAL % 16, keyPhase == 0);
+
+		for (uint32_t cycle = 0; cycle < cyclesPerFrame; ++cycle)
+		{
+			C8_FetchExecute(&instance);
+			if (instance.status == C8_STATUS_EXITED)
+				break;
+			if (instance.status != C8_STATUS_RUNNING || !IsInProgram(&instance))
+			{
+				run->hasCrashed = true;
+				run->crashFrame = frame;
+				break;
+			}
+		}
+
+		C8_UpdateTimers(&instance);
+
+		// Frames without any display writes are skipped without comparing them.
+		if (instance.displayGeneration != previousGeneration && memcmp(previousFramebuffer, instance.framebuffer, framebufferSize) != 0)
+		{
+			++run->activeFrames;
+			memcpy(previousFramebuffer, instance.framebuffer, framebufferSize);
+		}
+		previousGeneration = instance.displayGeneration;
+
+		if (!run->hasCrashed && IsSelfJump(&instance))
+			++run->stuckFrames;
+	}
+
+	C8_Reset(&instance);
+
+	// Crashing is penalised more heavily the earlier it happens.
+	run->score = (int32_t)run->activeFrames - (int32_t)run->stuckFrames;
+	if (run->hasCrashed)
+		run->score -= 4 * (int32_t)(frameCount - run->crashFrame);
+}
+
+void C8_DetectQuirks(const C8_Instance *instance, const C8_DetectionOptions options, JobPool *pool, C8_QuirkDetection *detection)
+{
+	DetectionJob job = {
+		.instance = instance,
+		.options = options,
+		.detection = detection
+	};
+
+	RunJobsOnPool(pool, C8_QUIRK_COMBINATIONS, ExecuteDetectionRun, &job);
+
+	const C8_DetectionRun *best = &detection->runs[0];
+	for (size_t i = 1; i < C8_QUIRK_COMBINATIONS; ++i)
+	{
+		const C8_DetectionRun *run = &detection->runs[i];
+		if (run->score > best->score || (run->score == best->score && QuirkDistance(run->config, instance->config) < QuirkDistance(best->config, instance->config)))
+			best = run;
+	}
+
+	detection->config = best->config;
+}
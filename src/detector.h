@@ -0,0 +1,60 @@
+#ifndef C8_DETECTOR_H
+#define C8_DETECTOR_H
+
+#include <stdint.h>
+
+#include "jobs.h"
+#include "vm.h"
+
+// The number of configurations evaluated during quirk detection: one for each combination of quirks.
+#define C8_QUIRK_COMBINATIONS 8
+
+// Controls how a program is executed while detecting quirks.
+typedef struct
+{
+	// The number of instructions executed per simulated second.
+	uint16_t cyclesPerSecond;
+
+	// The number of seconds to simulate under each configuration.
+	uint16_t seconds;
+} C8_DetectionOptions;
+
+// The outcome of executing a program under a single configuration.
+typedef struct
+{
+	C8_Config config;
+
+	// Higher scores indicate the program behaved more plausibly under this configuration.
+	int32_t score;
+
+	// True if the program faulted or the program counter left the loaded program.
+	// Exiting with the SUPER-CHIP 0x00FD instruction is not considered a crash.
+	bool hasCrashed;
+
+	// The simulated frame during which the program crashed, if it did.
+	uint32_t crashFrame;
+
+	// The number of simulated frames during which the display changed.
+	uint32_t activeFrames;
+
+	// The number of simulated frames ending in an instruction that jumps to itself.
+	uint32_t stuckFrames;
+} C8_DetectionRun;
+
+// The result of detecting which quirks a program expects.
+typedef struct
+{
+	// The configuration with the highest score.
+	C8_Config config;
+
+	// The outcome of executing the program under each combination of quirks.
+	C8_DetectionRun runs[C8_QUIRK_COMBINATIONS];
+} C8_QuirkDetection;
+
+// Speculatively executes the program loaded into the provided virtual machine under every combination of quirks
+// in parallel on the [pool], and selects the configuration under which it behaves most plausibly.
+// Ties are resolved in favour of the configuration closest to the instance's current configuration.
+// The provided virtual machine is not modified.
+void C8_DetectQuirks(const C8_Instance *instance, C8_DetectionOptions options, JobPool *pool, C8_QuirkDetection *detection);
+
+#endif // C8_DETECTOR_H
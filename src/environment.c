@@ -0,0 +1,188 @@
+#include <string.h>
+
+#include "environment.h"
+#include "random.h"
+
+// The number of environments stepped by each job, so that the cost of claiming a job is spread across several.
+#define ENVIRONMENTS_PER_JOB 16
+
+typedef struct
+{
+	C8_Environment *environments;
+	const uint8_t *actions;
+	size_t count;
+	const C8_EnvironmentOptions *options;
+	uint8_t *observations;
+	float *rewards;
+	bool *dones;
+} StepJob;
+
+// Returns true if the previous action should be repeated for the next frame, with the configured probability.
+static bool IsActionSticky(C8_Environment *environment, const float probability)
+{
+	if (probability <= 0.0f)
+		return false;
+
+	const uint32_t random = C8_NextRandom(&environment->randomState);
+	return (float)(random >> 8) / (float)(1 << 24) < probability;
+}
+
+// Rewinds an environment to its initial state, reusing its memory.
+// Episodes start from the initial state's reward, so the first step isn't credited with points already scored in it.
+static bool ResetEnvironment(C8_Environment *environment, const C8_EnvironmentOptions *options)
+{
+	environment->previousReward = C8_ReadProbe(environment->initial, options->reward);
+	environment->previousAction = C8_SEARCH_NO_KEY;
+	environment->episodeFrames = 0;
+	environment->isDone = false;
+	return C8_Fork(&environment->instance, environment->initial);
+}
+
+// Combines each pair of neighbouring pixels in a 64-pixel word into one, lit if either is, giving 32 pixels.
+static uint32_t CombinePixelPairs(const uint64_t word)
+{
+	uint32_t combined = 0;
+	for (uint8_t pair = 0; pair < 32; ++pair)
+	{
+		if (word >> (62 - 2 * pair) & 0x3)
+			combined |= 1u << (31 - pair);
+	}
+	return combined;
+}
+
+// Returns a 64-pixel row of the observation from one bitplane, combining 2x2 blocks in high-resolution mode.
+static uint64_t ObserveRow(const C8_Instance *instance, const uint8_t plane, const uint8_t y)
+{
+	if (!instance->isHighResolution)
+		return C8_GetDisplayRow(instance, plane, y)[0];
+
+	const uint64_t *top = C8_GetDisplayRow(instance, plane, y * 2);
+	const uint64_t *bottom = C8_GetDisplayRow(instance, plane, y * 2 + 1);
+	return (uint64_t)CombinePixelPairs(top[0] | bottom[0]) << 32 | CombinePixelPairs(top[1] | bottom[1]);
+}
+
+static void WriteObservation(const C8_Instance *instance, const C8_ObservationFormat format, uint8_t *observation)
+{
+	if (format == C8_OBSERVATION_BITS)
+	{
+		for (uint8_t y = 0; y < CHIP_8_DISPLAY_HEIGHT; ++y)
+		{
+			uint64_t row = 0;
+			for (uint8_t plane = 0; plane < instance->planeCount; ++plane)
+				row |= ObserveRow(instance, plane, y);
+
+			for (uint8_t byte = 0; byte < sizeof(uint64_t); ++byte)
+				observation[y * sizeof(uint64_t) + byte] = (uint8_t)(row >> (56 - 8 * byte));
+		}
+		return;
+	}
+
+	memset(observation, 0, C8_OBSERVATION_BYTES_SIZE);
+	for (uint8_t plane = 0; plane < instance->planeCount; ++plane)
+	{
+		for (uint8_t y = 0; y < CHIP_8_DISPLAY_HEIGHT; ++y)
+		{
+			const uint64_t row = ObserveRow(instance, plane, y);
+			uint8_t *pixels = &observation[y * CHIP_8_DISPLAY_WIDTH];
+			for (uint8_t x = 0; x < CHIP_8_DISPLAY_WIDTH; ++x)
+				pixels[x] |= (uint8_t)((row >> (63 - x) & 1) << plane);
+		}
+	}
+}
+
+static bool IsEpisodeOver(const C8_Environment *environment, const C8_EnvironmentOptions *options)
+{
+	if (environment->instance.status != C8_STATUS_RUNNING)
+		return true;
+	if (options->maxEpisodeFrames != 0 && environment->episodeFrames >= options->maxEpisodeFrames)
+		return true;
+	return options->hasDoneCondition && C8_TestProbeCondition(&environment->instance, options->doneCondition);
+}
+
+static void StepEnvironment(C8_Environment *environment, const uint8_t action, const C8_EnvironmentOptions *options,
+	uint8_t *observation, float *reward, bool *done)
+{
+	C8_Instance *instance = &environment->instance;
+
+	if (environment->isDone)
+		environment->isDone = !ResetEnvironment(environment, options);
+
+	const uint16_t frameCount = options->frameSkip ? options->frameSkip : 1;
+	for (uint16_t frame = 0; frame < frameCount && !environment->isDone; ++frame)
+	{
+		if (!IsActionSticky(environment, options->stickyActionProbability))
+			environment->previousAction = action;
+		C8_ApplyAction(instance, environment->previousAction);
+
+		for (uint16_t cycle = 0; cycle < options->cyclesPerFrame; ++cycle)
+			C8_FetchExecute(instance);
+		C8_UpdateTimers(instance);
+
+		++environment->episodeFrames;
+		environment->isDone = IsEpisodeOver(environment, options);
+	}
+
+	const int64_t value = C8_ReadProbe(instance, options->reward);
+	*reward = (float)(value - environment->previousReward);
+	environment->previousReward = value;
+
+	WriteObservation(instance, options->observationFormat, observation);
+	*done = environment->isDone;
+}
+
+static void StepEnvironmentBatch(void *userData, const size_t jobIndex)
+{
+	const StepJob *job = userData;
+	const size_t observationSize = job->options->observationFormat == C8_OBSERVATION_BITS ? C8_OBSERVATION_BITS_SIZE : C8_OBSERVATION_BYTES_SIZE;
+
+	const size_t first = jobIndex * ENVIRONMENTS_PER_JOB;
+	const size_t end = first + ENVIRONMENTS_PER_JOB < job->count ? first + ENVIRONMENTS_PER_JOB : job->count;
+	for (size_t i = first; i < end; ++i)
+	{
+		StepEnvironment(&job->environments[i], job->actions[i], job->options,
+			job->observations + i * observationSize, &job->rewards[i], &job->dones[i]);
+	}
+}
+
+bool C8_CreateEnvironments(C8_Environment *environments, const size_t count, const C8_Instance *initial, const C8_EnvironmentOptions *options, const uint32_t seed)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		// Each environment's seed is scrambled from its index, so that neighbouring environments don't draw correlated
+		// sequences.
+		const uint32_t randomState = C8_MixSeed(seed, i);
+		environments[i] = (C8_Environment){
+			.initial = initial,
+			.randomState = randomState ? randomState : 1
+		};
+
+		if (!ResetEnvironment(&environments[i], options))
+		{
+			C8_FreeEnvironments(environments, i + 1);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void C8_StepEnvironments(C8_Environment *environments, const uint8_t *actions, const size_t count, const C8_EnvironmentOptions *options,
+	JobPool *pool, uint8_t *observations, float *rewards, bool *dones)
+{
+	StepJob job = {
+		.environments = environments,
+		.actions = actions,
+		.count = count,
+		.options = options,
+		.observations = observations,
+		.rewards = rewards,
+		.dones = dones
+	};
+	RunJobsOnPool(pool, (count + ENVIRONMENTS_PER_JOB - 1) / ENVIRONMENTS_PER_JOB, StepEnvironmentBatch, &job);
+}
+
+void C8_FreeEnvironments(C8_Environment *environments, const size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+		C8_Reset(&environments[i].instance);
+}
@@ -0,0 +1,93 @@
+#ifndef C8_ENVIRONMENT_H
+#define C8_ENVIRONMENT_H
+
+#include <stdint.h>
+
+#include "jobs.h"
+#include "probe.h"
+#include "search.h"
+#include "vm.h"
+
+// The size (in bytes) of an observation packed one bit per pixel, as rows of 8 bytes with the leftmost pixel in the
+// most significant bit of each row's first byte.
+#define C8_OBSERVATION_BITS_SIZE (CHIP_8_DISPLAY_WIDTH * CHIP_8_DISPLAY_HEIGHT / 8)
+
+// The size (in bytes) of an observation stored one byte per pixel.
+#define C8_OBSERVATION_BYTES_SIZE (CHIP_8_DISPLAY_WIDTH * CHIP_8_DISPLAY_HEIGHT)
+
+// Describes how the display is written to the observation buffer. Observations are always 64x32; in high-resolution mode,
+// each observed pixel covers a 2x2 block of the display and is lit if any pixel in the block is.
+typedef enum
+{
+	// One bit per pixel, set if the pixel is lit in any bitplane; C8_OBSERVATION_BITS_SIZE bytes per environment.
+	C8_OBSERVATION_BITS,
+
+	// One byte per pixel, holding the bitmask of the bitplanes the pixel is lit in; C8_OBSERVATION_BYTES_SIZE bytes per environment.
+	C8_OBSERVATION_BYTES
+} C8_ObservationFormat;
+
+// Configures how a batch of environments is stepped.
+typedef struct
+{
+	C8_ObservationFormat observationFormat;
+
+	// The number of instructions executed per frame.
+	uint16_t cyclesPerFrame;
+
+	// The number of frames each action is repeated for per step. Zero is treated as one.
+	uint16_t frameSkip;
+
+	// The probability of repeating the previous action for a frame instead of taking the new one, which keeps agents
+	// from memorising a deterministic program's input sequence.
+	float stickyActionProbability;
+
+	// The reward for a step is the change in the value read by this probe.
+	C8_MemoryProbe reward;
+
+	// If [hasDoneCondition] is true, an episode ends once the condition holds.
+	// Episodes also end if the program faults or exits, or after [maxEpisodeFrames] frames unless it is zero.
+	bool hasDoneCondition;
+	C8_ProbeCondition doneCondition;
+	uint32_t maxEpisodeFrames;
+} C8_EnvironmentOptions;
+
+// A single environment in a batch, running its own copy of a program.
+typedef struct
+{
+	C8_Instance instance;
+
+	// The state each episode starts from, shared by every environment created from it.
+	const C8_Instance *initial;
+
+	// The value of the reward probe at the end of the previous step.
+	int64_t previousReward;
+
+	// The action taken in the previous frame, repeated by sticky actions.
+	uint8_t previousAction;
+
+	// The number of frames played in the current episode.
+	uint32_t episodeFrames;
+
+	// If true, the environment is rewound to [initial] before its next step.
+	bool isDone;
+
+	// The state of the random number generator deciding whether actions stick.
+	uint32_t randomState;
+} C8_Environment;
+
+// Starts [count] environments from the [initial] state, which must outlive them. Each environment allocates its display
+// memory once here; stepping and resetting reuse it. Environments are seeded from [seed] and their index.
+// Returns true if all environments were created; otherwise, false, in which case none hold any memory.
+bool C8_CreateEnvironments(C8_Environment *environments, size_t count, const C8_Instance *initial, const C8_EnvironmentOptions *options, uint32_t seed);
+
+// Steps [count] environments in parallel on the [pool], each taking the action at the same index in [actions]:
+// a key from 0x0-0xF or C8_SEARCH_NO_KEY. Environments whose episode ended in the previous step are first rewound to
+// their initial state. For each environment, writes its observation to the contiguous [observations] buffer, at an
+// offset of its index times the observation size, along with its reward and whether its episode ended.
+void C8_StepEnvironments(C8_Environment *environments, const uint8_t *actions, size_t count, const C8_EnvironmentOptions *options,
+	JobPool *pool, uint8_t *observations, float *rewards, bool *dones);
+
+// Frees the memory held by [count] environments.
+void C8_FreeEnvironments(C8_Environment *environments, size_t count);
+
+#endif // C8_ENVIRONMENT_H
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL3/SDL.h>
+#include <SDL3_ttf/SDL_ttf.h>
+
+#include "glyph_atlas.h"
+
+// The maximum height (in pixels) the atlas may grow to.
+static constexpr int MAXIMUM_ATLAS_HEIGHT = 4096;
+
+// The gap left between glyphs, so that sampling one never picks up the edge of its neighbour.
+static constexpr int GLYPH_PADDING = 1;
+
+typedef struct
+{
+    uint8_t *pixels;
+    int height;
+
+    // The position of the next glyph on the current shelf, and the height of the tallest glyph on it.
+    int shelfX;
+    int shelfY;
+    int shelfHeight;
+} Atlas;
+
+static void PrintUsage(void)
+{
+    fprintf(stderr,
+        "Usage: C8VM-FontBaker <output.c> <font.ttf> <size> [<font.ttf> <size>]...\n"
+        "\n"
+        "Rasterises each font at the given size into a glyph atlas and writes it out as C source.\n"
+        "Fonts must be listed in the order of the Font enumeration in core.h.\n");
+}
+
+// Reserves space for a [width] x [height] glyph on the current shelf, starting a new shelf if it doesn't fit.
+static bool PlaceGlyph(Atlas *atlas, const int width, const int height, int *x, int *y)
+{
+    if (width > GLYPH_ATLAS_WIDTH)
+        return false;
+
+    if (atlas->shelfX + width > GLYPH_ATLAS_WIDTH)
+    {
+        atlas->shelfX = 0;
+        atlas->shelfY += atlas->shelfHeight + GLYPH_PADDING;
+        atlas->shelfHeight = 0;
+    }
+
+    if (atlas->shelfY + height > MAXIMUM_ATLAS_HEIGHT)
+        return false;
+
+    *x = atlas->shelfX;
+    *y = atlas->shelfY;
+
+    atlas->shelfX += width + GLYPH_PADDING;
+    atlas->shelfHeight = SDL_max(atlas->shelfHeight, height);
+    atlas->height = SDL_max(atlas->height, atlas->shelfY + height);
+    return true;
+}
+
+// Rasterises a glyph, crops it to its lit pixels and copies it into the atlas.
+static bool BakeGlyph(Atlas *atlas, TTF_Font *font, const char character, BakedGlyph *glyph)
+{
+    int minX, maxX, minY, maxY, advance;
+    if (!TTF_GetGlyphMetrics(font, (Uint32)character, &minX, &maxX, &minY, &maxY, &advance))
+        return false;
+
+    *glyph = (BakedGlyph){ .advance = (int16_t)advance };
+
+    SDL_Surface *rendered = TTF_RenderGlyph_Blended(font, (Uint32)character, (SDL_Color){ 255, 255, 255, 255 });
+    if (!rendered)
+        return character == ' ';
+
+    SDL_Surface *surface = SDL_ConvertSurface(rendered, SDL_PIXELFORMAT_RGBA32);
+    SDL_DestroySurface(rendered);
+    if (!surface)
+        return false;
+
+    // Glyphs are rendered as a line of text, so crop the empty space around them.
+    int left = surface->w, top = surface->h, right = -1, bottom = -1;
+    for (int y = 0; y < surface->h; ++y)
+    {
+        const Uint8 *row = (const Uint8 *)surface->pixels + y * surface->pitch;
+        for (int x = 0; x < surface->w; ++x)
+        {
+            if (row[x * 4 + 3] == 0)
+                continue;
+            left = SDL_min(left, x);
+            right = SDL_max(right, x);
+            top = SDL_min(top, y);
+            bottom = SDL_max(bottom, y);
+        }
+    }
+
+    bool isBaked = true;
+    if (right >= left)
+    {
+        const int width = right - left + 1;
+        const int height = bottom - top + 1;
+
+        int atlasX, atlasY;
+        isBaked = PlaceGlyph(atlas, width, height, &atlasX, &atlasY);
+        if (isBaked)
+        {
+            for (int y = 0; y < height; ++y)
+            {
+                const Uint8 *row = (const Uint8 *)surface->pixels + (top + y) * surface->pitch;
+                for (int x = 0; x < width; ++x)
+                    atlas->pixels[(atlasY + y) * GLYPH_ATLAS_WIDTH + atlasX + x] = row[(left + x) * 4 + 3];
+            }
+
+            glyph->x = (uint16_t)atlasX;
+            glyph->y = (uint16_t)atlasY;
+            glyph->width = (uint16_t)width;
+            glyph->height = (uint16_t)height;
+            glyph->offsetX = (int16_t)left;
+            glyph->offsetY = (int16_t)top;
+        }
+    }
+
+    SDL_DestroySurface(surface);
+    return isBaked;
+}
+
+static bool WriteSource(const char *path, const Atlas *atlas, const BakedFont *fonts, const BakedGlyph *glyphs, const int fontCount)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
+
+    fprintf(file, "// Generated by C8VM-FontBaker; do not edit.\n\n#include \"glyph_atlas.h\"\n\n");
+    fprintf(file, "const uint16_t GLYPH_ATLAS_HEIGHT = %d;\n\n", atlas->height);
+
+    fprintf(file, "const uint8_t GLYPH_ATLAS_PIXELS[] = {");
+    for (int i = 0; i < GLYPH_ATLAS_WIDTH * atlas->height; ++i)
+        fprintf(file, "%s%d,", i % 32 == 0 ? "\n    " : "", atlas->pixels[i]);
+    fprintf(file, "\n};\n\n");
+
+    for (int font = 0; font < fontCount; ++font)
+    {
+        fprintf(file, "static const BakedGlyph FONT_%d_GLYPHS[] = {\n", font);
+        for (int i = 0; i < GLYPH_ATLAS_CHARACTER_COUNT; ++i)
+        {
+            const BakedGlyph *glyph = &glyphs[font * GLYPH_ATLAS_CHARACTER_COUNT + i];
+            fprintf(file, "    { %d, %d, %d, %d, %d, %d, %d },\n", glyph->x, glyph->y, glyph->width, glyph->height, glyph->offsetX, glyph->offsetY, glyph->advance);
+        }
+        fprintf(file, "};\n\n");
+    }
+
+    fprintf(file, "const BakedFont BAKED_FONTS[] = {\n");
+    for (int font = 0; font < fontCount; ++font)
+        fprintf(file, "    { %d, %d, FONT_%d_GLYPHS },\n", fonts[font].size, fonts[font].lineHeight, font);
+    fprintf(file, "};\n\nconst int BAKED_FONT_COUNT = %d;\n", fontCount);
+
+    return fclose(file) == 0;
+}
+
+int main(const int argc, char *argv[])
+{
+    if (argc < 4 || (argc - 2) % 2 != 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (!TTF_Init())
+    {
+        fprintf(stderr, "TTF_Init failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    const int fontCount = (argc - 2) / 2;
+    Atlas atlas = { .pixels = calloc(GLYPH_ATLAS_WIDTH * MAXIMUM_ATLAS_HEIGHT, 1) };
+    BakedFont *fonts = calloc(fontCount, sizeof(BakedFont));
+    BakedGlyph *glyphs = calloc((size_t)fontCount * GLYPH_ATLAS_CHARACTER_COUNT, sizeof(BakedGlyph));
+    if (!atlas.pixels || !fonts || !glyphs)
+    {
+        fprintf(stderr, "Failed to allocate memory.\n");
+        return 1;
+    }
+
+    int result = 0;
+
+    // Reserve the solid square before any glyphs, so that it always sits at the top-left of the atlas.
+    int solidX, solidY;
+    PlaceGlyph(&atlas, GLYPH_ATLAS_SOLID_SIZE, GLYPH_ATLAS_SOLID_SIZE, &solidX, &solidY);
+    for (int y = 0; y < GLYPH_ATLAS_SOLID_SIZE; ++y)
+        memset(&atlas.pixels[(solidY + y) * GLYPH_ATLAS_WIDTH + solidX], 255, GLYPH_ATLAS_SOLID_SIZE);
+
+    for (int i = 0; i < fontCount && result == 0; ++i)
+    {
+        const char *path = argv[2 + i * 2];
+        const int size = atoi(argv[3 + i * 2]);
+
+        TTF_Font *font = TTF_OpenFont(path, (float)size);
+        if (!font)
+        {
+            fprintf(stderr, "%s: %s\n", path, SDL_GetError());
+            result = 1;
+            break;
+        }
+
+        fonts[i] = (BakedFont){
+            .size = (uint16_t)size,
+            .lineHeight = (uint16_t)TTF_GetFontHeight(font)
+        };
+
+        for (char character = GLYPH_ATLAS_FIRST_CHARACTER; character <= GLYPH_ATLAS_LAST_CHARACTER; ++character)
+        {
+            if (!BakeGlyph(&atlas, font, character, &glyphs[i * GLYPH_ATLAS_CHARACTER_COUNT + character - GLYPH_ATLAS_FIRST_CHARACTER]))
+            {
+                fprintf(stderr, "%s: failed to bake glyph '%c' at size %d: %s\n", path, character, size, SDL_GetError());
+                result = 1;
+                break;
+            }
+        }
+
+        TTF_CloseFont(font);
+    }
+
+    if (result == 0 && !WriteSource(argv[1], &atlas, fonts, glyphs, fontCount))
+    {
+        fprintf(stderr, "%s: failed to write atlas source.\n", argv[1]);
+        result = 1;
+    }
+
+    if (result == 0)
+        printf("Baked %d font(s) into a %dx%d atlas.\n", fontCount, GLYPH_ATLAS_WIDTH, atlas.height);
+
+    free(glyphs);
+    free(fonts);
+    free(atlas.pixels);
+    TTF_Quit();
+
+    return result;
+}
@@ -0,0 +1,94 @@
+#include <errno.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <SDL3/SDL.h>
+
+#include "frame_export.h"
+
+bool CreateFrameExport(FrameExport *frameExport, const char *name)
+{
+    *frameExport = (FrameExport){ 0 };
+
+#if defined(__unix__) || defined(__APPLE__)
+    if (SDL_strlcpy(frameExport->name, name, sizeof(frameExport->name)) >= sizeof(frameExport->name))
+        return SDL_SetError("Shared memory name '%s' is too long", name);
+
+    const int descriptor = shm_open(name, O_CREAT | O_RDWR, 0600);
+    if (descriptor < 0)
+        return SDL_SetError("shm_open failed: %s", strerror(errno));
+
+    void *memory = MAP_FAILED;
+    if (ftruncate(descriptor, sizeof(SharedFrame)) == 0)
+        memory = mmap(nullptr, sizeof(SharedFrame), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+
+    // The mapping keeps the segment alive, so the descriptor is no longer needed.
+    const int error = errno;
+    close(descriptor);
+
+    if (memory == MAP_FAILED)
+    {
+        shm_unlink(name);
+        return SDL_SetError("Failed to map shared memory: %s", strerror(error));
+    }
+
+    frameExport->shared = memory;
+    memset(frameExport->shared, 0, sizeof(SharedFrame));
+    frameExport->shared->magic = SHARED_FRAME_MAGIC;
+    frameExport->shared->version = SHARED_FRAME_VERSION;
+    return true;
+#else
+    (void)name;
+    return SDL_SetError("Shared memory export is not supported on this platform");
+#endif
+}
+
+void PublishFrame(FrameExport *frameExport, const C8_Instance *instance)
+{
+    SharedFrame *shared = frameExport->shared;
+    if (!shared)
+        return;
+
+    // Make the sequence odd before touching the frame, so that readers discard anything they read while it changes.
+    const uint64_t sequence = atomic_load_explicit(&shared->sequence, memory_order_relaxed);
+    atomic_store_explicit(&shared->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    ++shared->frame;
+    shared->displayGeneration = instance->displayGeneration;
+    shared->displayWidth = C8_GetDisplayWidth(instance);
+    shared->displayHeight = C8_GetDisplayHeight(instance);
+    shared->displayRowWords = instance->displayRowWords;
+    shared->planeCount = instance->planeCount;
+    shared->status = (uint8_t)instance->status;
+    memcpy(shared->v, instance->v, sizeof(shared->v));
+    shared->i = instance->i;
+    shared->pc = instance->pc;
+    shared->sp = instance->sp;
+    shared->dt = instance->dt;
+    shared->st = instance->st;
+    memcpy(shared->stack, instance->stack, sizeof(shared->stack));
+
+    if (instance->framebuffer)
+        memcpy(shared->framebuffer, instance->framebuffer, C8_GetFramebufferSize(instance));
+
+    atomic_store_explicit(&shared->sequence, sequence + 2, memory_order_release);
+}
+
+void FreeFrameExport(FrameExport *frameExport)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (frameExport->shared)
+    {
+        munmap(frameExport->shared, sizeof(SharedFrame));
+        shm_unlink(frameExport->name);
+    }
+#endif
+
+    *frameExport = (FrameExport){ 0 };
+}
@@ -0,0 +1,87 @@
+#ifndef C8VM_FRAME_EXPORT_H
+#define C8VM_FRAME_EXPORT_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vm.h"
+
+// Identifies a shared frame segment, and the version of its layout.
+#define SHARED_FRAME_MAGIC   0x46563843u // "C8VF"
+#define SHARED_FRAME_VERSION 2
+
+// The layout of the shared-memory segment that the framebuffer and registers are exported into once per frame.
+// Consumers map the segment read-only and read it in place with the seqlock protocol:
+//   1. Load [sequence] with acquire ordering; if it is odd, a frame is being written, so try again.
+//   2. Read the fields needed, then issue an acquire fence.
+//   3. Load [sequence] again; if it changed, the frame was overwritten while being read, so discard it and try again.
+// The writer never waits for readers, so polling the segment has no effect on the emulator.
+// Only fixed-size fields are used, so that consumers built with other compilers or languages agree on the layout.
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+
+    // Incremented before and after each frame is written; odd while a write is in progress.
+    // Kept on its own cache line, so that readers spinning on it don't contend with the frame data.
+    alignas(64) _Atomic uint64_t sequence;
+
+    // The number of frames published since the export was created.
+    alignas(64) uint64_t frame;
+
+    // Incremented whenever the display changes, as C8_Instance.displayGeneration.
+    uint32_t displayGeneration;
+
+    // The current display mode, and the layout of [framebuffer] as described by C8_Instance.framebuffer.
+    uint8_t displayWidth;
+    uint8_t displayHeight;
+    uint8_t displayRowWords;
+    uint8_t planeCount;
+
+    // The instance's C8_Status.
+    uint8_t status;
+    uint8_t v[16];
+    uint16_t i;
+    uint16_t pc;
+    uint16_t sp;
+    uint8_t dt;
+    uint8_t st;
+    uint16_t stack[CHIP_8_STACK_DEPTH];
+
+    uint64_t framebuffer[C8_FRAMEBUFFER_MAX_WORDS];
+} SharedFrame;
+
+// Changing any of these offsets changes the layout, so SHARED_FRAME_VERSION must be incremented with them.
+static_assert(offsetof(SharedFrame, sequence) == 64);
+static_assert(offsetof(SharedFrame, frame) == 128);
+static_assert(offsetof(SharedFrame, displayGeneration) == 136);
+static_assert(offsetof(SharedFrame, status) == 144);
+static_assert(offsetof(SharedFrame, v) == 145);
+static_assert(offsetof(SharedFrame, i) == 162);
+static_assert(offsetof(SharedFrame, stack) == 170);
+static_assert(offsetof(SharedFrame, framebuffer) == 208);
+// The segment is padded to a whole number of cache lines after the framebuffer.
+static_assert(sizeof(SharedFrame) == (208 + sizeof(uint64_t) * C8_FRAMEBUFFER_MAX_WORDS + 63) / 64 * 64);
+
+// A shared-memory segment that frames are published to.
+typedef struct
+{
+    SharedFrame *shared;
+
+    // The name the segment was created under, so that it can be unlinked.
+    char name[64];
+} FrameExport;
+
+// Creates a POSIX shared-memory segment called [name] (e.g. "/c8vm") and maps it into the [frameExport].
+// Returns true if the segment was created; otherwise, false, with the reason available from SDL_GetError.
+// Not supported on platforms without POSIX shared memory.
+bool CreateFrameExport(FrameExport *frameExport, const char *name);
+
+// Copies the framebuffer and registers of [instance] into the [frameExport], advancing its frame counter.
+void PublishFrame(FrameExport *frameExport, const C8_Instance *instance);
+
+// Unmaps and unlinks the segment held by the [frameExport], and zeroes all fields.
+void FreeFrameExport(FrameExport *frameExport);
+
+#endif // C8VM_FRAME_EXPORT_H
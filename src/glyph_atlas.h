@@ -0,0 +1,56 @@
+#ifndef C8VM_GLYPH_ATLAS_H
+#define C8VM_GLYPH_ATLAS_H
+
+#include <stdint.h>
+
+// The first and last characters rasterised into the atlas; other characters are drawn as GLYPH_ATLAS_FALLBACK.
+#define GLYPH_ATLAS_FIRST_CHARACTER ' '
+#define GLYPH_ATLAS_LAST_CHARACTER '~'
+#define GLYPH_ATLAS_CHARACTER_COUNT (GLYPH_ATLAS_LAST_CHARACTER - GLYPH_ATLAS_FIRST_CHARACTER + 1)
+#define GLYPH_ATLAS_FALLBACK '?'
+
+// The width (in pixels) of the atlas; its height depends on the fonts baked into it.
+#define GLYPH_ATLAS_WIDTH 512
+
+// The size (in pixels) of the fully covered square at the top-left of the atlas, sampled when drawing solid shapes
+// so that they can be submitted in the same batch as text.
+#define GLYPH_ATLAS_SOLID_SIZE 2
+
+// The location of a glyph in the atlas and how it is positioned relative to the pen.
+typedef struct
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+
+    // The offset from the pen position at the top of the line to the top-left corner of the glyph.
+    int16_t offsetX;
+    int16_t offsetY;
+
+    // The distance the pen moves after drawing the glyph.
+    int16_t advance;
+} BakedGlyph;
+
+// A font rasterised at a single size, indexed by the application's Font enumeration.
+typedef struct
+{
+    uint16_t size;
+
+    // The height (in pixels) of a line of text.
+    uint16_t lineHeight;
+
+    // One glyph per character from GLYPH_ATLAS_FIRST_CHARACTER to GLYPH_ATLAS_LAST_CHARACTER.
+    const BakedGlyph *glyphs;
+} BakedFont;
+
+// The height (in pixels) of the atlas.
+extern const uint16_t GLYPH_ATLAS_HEIGHT;
+
+// The coverage of each atlas pixel, one byte per pixel, in rows of GLYPH_ATLAS_WIDTH.
+extern const uint8_t GLYPH_ATLAS_PIXELS[];
+
+extern const BakedFont BAKED_FONTS[];
+extern const int BAKED_FONT_COUNT;
+
+#endif // C8VM_GLYPH_ATLAS_H
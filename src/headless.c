@@ -0,0 +1,957 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL3/SDL.h>
+
+#include "analyzer.h"
+#include "conformance.h"
+#include "control.h"
+#include "detector.h"
+#include "environment.h"
+#include "jobs.h"
+#include "movie.h"
+#include "pool.h"
+#include "probe.h"
+#include "random.h"
+#include "search.h"
+#include "vm.h"
+
+static constexpr uint16_t DEFAULT_CLOCK_RATE = 600;
+static constexpr uint16_t DEFAULT_DETECTION_SECONDS = 3;
+static constexpr size_t DEFAULT_POOL_INSTANCES = 100000;
+static constexpr uint16_t DEFAULT_FORK_WARM_UP_FRAMES = 60;
+static constexpr double FORK_BENCHMARK_SECONDS = 1.0;
+static constexpr uint32_t DEFAULT_SEARCH_STEPS = 300;
+static constexpr uint32_t DEFAULT_BEAM_WIDTH = 128;
+static constexpr uint16_t SEARCH_FRAMES_PER_STEP = 4;
+static constexpr size_t DEFAULT_ENVIRONMENT_COUNT = 1024;
+static constexpr uint32_t DEFAULT_ENVIRONMENT_STEPS = 1000;
+static constexpr uint16_t ENVIRONMENT_FRAME_SKIP = 4;
+static constexpr float ENVIRONMENT_STICKY_ACTION_PROBABILITY = 0.25f;
+static constexpr uint32_t DEFAULT_RUN_SECONDS = 600;
+static constexpr uint32_t CONFORMANCE_SECONDS = 60;
+static constexpr uint32_t CONFORMANCE_CHECK_INTERVAL = 100;
+static constexpr uint32_t CONFORMANCE_INPUT_SEED = 0xC8C8C8C8u;
+
+static constexpr C8_Config DEFAULT_CONFIG = {
+    .useParameterisedShift = true,
+    .useParameterisedJump = true,
+    .useTemporaryIndex = true
+};
+
+// The platform selected with --platform. Without it, commands that run a program load it with the configuration
+// suggested by the static analyzer.
+static bool isPlatformSelected = false;
+static C8_Platform selectedPlatform = C8_PLATFORM_CHIP_8;
+
+static void PrintUsage(void)
+{
+    fprintf(stderr,
+        "Usage: C8VM-Headless [--platform <platform>] <command> [arguments]\n"
+        "\n"
+        "The pool, fork, search, env and run commands load programs on <platform> (chip-8, super-chip or xo-chip)\n"
+        "with the default quirks if given; otherwise, with the platform and quirks suggested by the static analyzer.\n"
+        "\n"
+        "Commands:\n"
+        "  analyze <program>...    Statically analyses each program and suggests a quirk configuration.\n"
+        "  detect <program>...     Executes each program under every quirk configuration in parallel and selects the most plausible.\n"
+        "  pool <program> [count]  Times creating and resetting [count] copies of a program with the instance pool and with the C heap.\n"
+        "  fork <program> [frames] Measures forks per second of a program's state after [frames] frames, with and without stepping a frame.\n"
+        "  search <program> <probe> [steps] [width]\n"
+        "                          Beam searches for the keypad inputs that maximise the value read by <probe>.\n"
+        "  env <program> <probe> [count] [steps]\n"
+        "                          Steps [count] environments [steps] times with random actions, rewarding changes to <probe>.\n"
+        "  serve <socket> [program]\n"
+        "                          Executes commands from scripts connected to a UNIX-domain socket until told to quit.\n"
+        "  run <program> [seconds] Runs a program for [seconds] of guest time with guest timers, printing its final state hash.\n"
+        "  conform <program>...    Checks the batched engine against the reference under every quirk configuration in parallel.\n"
+        "  replay <program> <movie>\n"
+        "                          Replays a movie recorded with --record as fast as possible, checking every frame's state.\n"
+        "\n"
+        "Probes are written as <format>:<address>[:<length>], where <format> is one of:\n"
+        "  bcd       A decimal number stored one digit per byte, as written by 0xFX33.\n"
+        "  unsigned  A big-endian unsigned integer.\n"
+        "  register  The V register whose index is <address>.\n");
+}
+
+static bool ParsePlatform(const char *name, C8_Platform *platform)
+{
+    if (strcmp(name, "chip-8") == 0)
+        *platform = C8_PLATFORM_CHIP_8;
+    else if (strcmp(name, "super-chip") == 0)
+        *platform = C8_PLATFORM_SUPER_CHIP;
+    else if (strcmp(name, "xo-chip") == 0)
+        *platform = C8_PLATFORM_XO_CHIP;
+    else
+        return false;
+
+    return true;
+}
+
+// Loads a program for a command that runs it, on the platform selected with --platform or with the configuration
+// suggested by the static analyzer. Settings the analyzer doesn't infer, such as cyclesPerTimerTick, are kept.
+static bool LoadCommandProgram(C8_Instance *instance, const char *filePath, char **error)
+{
+    if (isPlatformSelected)
+    {
+        instance->config.platform = selectedPlatform;
+        return C8_LoadProgram(instance, filePath, error);
+    }
+
+    static C8_Analysis analysis;
+    return C8_LoadProgramFileDetected(instance, filePath, &analysis, error);
+}
+
+static const char *DescribeQuirk(const bool isEnabled, const C8_QuirkEvidence evidence)
+{
+    if (!C8_IsQuirkSettled(evidence))
+        return isEnabled ? "on?" : "off?";
+    return isEnabled ? "on" : "off";
+}
+
+static int AnalyzeCommand(const int argc, char *argv[])
+{
+    if (argc < 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    static uint8_t program[C8_MAX_PROGRAM_SIZE];
+    static C8_Analysis analysis;
+
+    const double ticksPerMicrosecond = (double)SDL_GetPerformanceFrequency() / 1000000.0;
+    uint64_t totalTicks = 0;
+    int analysedCount = 0;
+
+    for (int i = 0; i < argc; ++i)
+    {
+        // Programs are analysed without being loaded, so that the platform doesn't limit their size.
+        char *error;
+        size_t programSize;
+        if (!C8_ReadProgram(argv[i], program, &programSize, &error))
+        {
+            fprintf(stderr, "%s: %s\n", argv[i], error);
+            continue;
+        }
+
+        const uint64_t ticksStart = SDL_GetPerformanceCounter();
+        C8_AnalyzeProgramBytes(program, programSize, DEFAULT_CONFIG, &analysis);
+        const uint64_t ticksElapsed = SDL_GetPerformanceCounter() - ticksStart;
+
+        totalTicks += ticksElapsed;
+        ++analysedCount;
+
+        printf("%s: shift=%s (%u/%u) jump=%s (%u/%u) index=%s (%u/%u) instructions=%u%s [%.2fus]\n",
+            argv[i],
+            DescribeQuirk(analysis.config.useParameterisedShift, analysis.parameterisedShift),
+            analysis.parameterisedShift.enabled, analysis.parameterisedShift.disabled,
+            DescribeQuirk(analysis.config.useParameterisedJump, analysis.parameterisedJump),
+            analysis.parameterisedJump.enabled, analysis.parameterisedJump.disabled,
+            DescribeQuirk(analysis.config.useTemporaryIndex, analysis.temporaryIndex),
+            analysis.temporaryIndex.enabled, analysis.temporaryIndex.disabled,
+            analysis.instructionCount,
+            analysis.usesXoChipInstructions ? " xo-chip" : analysis.usesSuperChipInstructions ? " super-chip" : "",
+            (double)ticksElapsed / ticksPerMicrosecond);
+    }
+
+    if (analysedCount > 0)
+        printf("Analysed %d program(s) in %.2fus (%.2fus per program)\n", analysedCount, (double)totalTicks / ticksPerMicrosecond, (double)totalTicks / ticksPerMicrosecond / analysedCount);
+
+    return analysedCount == argc ? 0 : 1;
+}
+
+static int DetectCommand(const int argc, char *argv[])
+{
+    if (argc < 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    JobPool *pool = CreateJobPool(0);
+    if (!pool)
+    {
+        fprintf(stderr, "CreateJobPool failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    static C8_Instance instance;
+    static C8_Analysis analysis;
+    static C8_QuirkDetection detection;
+
+    const C8_DetectionOptions options = {
+        .cyclesPerSecond = DEFAULT_CLOCK_RATE,
+        .seconds = DEFAULT_DETECTION_SECONDS
+    };
+
+    int detectedCount = 0;
+
+    for (int i = 0; i < argc; ++i)
+    {
+        C8_Reset(&instance);
+        instance.config = DEFAULT_CONFIG;
+
+        // Ties between configurations are resolved in favour of the static analyzer's suggestion.
+        char *error;
+        if (!C8_LoadProgramFileDetected(&instance, argv[i], &analysis, &error))
+        {
+            fprintf(stderr, "%s: %s\n", argv[i], error);
+            continue;
+        }
+
+        const uint64_t ticksStart = SDL_GetTicksNS();
+        C8_DetectQuirks(&instance, options, pool, &detection);
+        const uint64_t ticksElapsed = SDL_GetTicksNS() - ticksStart;
+
+        ++detectedCount;
+
+        printf("%s: shift=%s jump=%s index=%s [%.2fms]\n",
+            argv[i],
+            detection.config.useParameterisedShift ? "on" : "off",
+            detection.config.useParameterisedJump ? "on" : "off",
+            detection.config.useTemporaryIndex ? "on" : "off",
+            (double)ticksElapsed / 1000000.0);
+
+        for (size_t j = 0; j < C8_QUIRK_COMBINATIONS; ++j)
+        {
+            const C8_DetectionRun *run = &detection.runs[j];
+            printf("  shift=%-3s jump=%-3s index=%-3s score=%6d active=%4u stuck=%4u",
+                run->config.useParameterisedShift ? "on" : "off",
+                run->config.useParameterisedJump ? "on" : "off",
+                run->config.useTemporaryIndex ? "on" : "off",
+                run->score, run->activeFrames, run->stuckFrames);
+            if (run->hasCrashed)
+                printf(" crashed@%u", run->crashFrame);
+            printf("\n");
+        }
+    }
+
+    C8_Reset(&instance);
+    FreeJobPool(pool);
+
+    return detectedCount == argc ? 0 : 1;
+}
+
+static double MillisecondsSince(const uint64_t ticksStart)
+{
+    return (double)(SDL_GetTicksNS() - ticksStart) / 1000000.0;
+}
+
+static int PoolCommand(const int argc, char *argv[])
+{
+    if (argc < 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const size_t count = argc >= 2 ? strtoull(argv[1], nullptr, 10) : DEFAULT_POOL_INSTANCES;
+    if (count == 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    static C8_Instance instance;
+    instance.config = DEFAULT_CONFIG;
+
+    char *error;
+    if (!LoadCommandProgram(&instance, argv[0], &error))
+    {
+        fprintf(stderr, "%s: %s\n", argv[0], error);
+        return 1;
+    }
+
+    C8_Instance **instances = malloc(count * sizeof(C8_Instance *));
+    if (!instances)
+    {
+        fprintf(stderr, "Failed to allocate memory.\n");
+        C8_Reset(&instance);
+        return 1;
+    }
+
+    int result = 0;
+
+    // Each instance is copied from the C heap, then freed individually.
+    uint64_t ticksStart = SDL_GetTicksNS();
+    size_t heapCount = 0;
+    for (; heapCount < count; ++heapCount)
+    {
+        instances[heapCount] = malloc(sizeof(C8_Instance));
+        if (!instances[heapCount] || !C8_CopyInstance(instances[heapCount], &instance))
+        {
+            free(instances[heapCount]);
+            break;
+        }
+    }
+    const double heapCreateTime = MillisecondsSince(ticksStart);
+
+    ticksStart = SDL_GetTicksNS();
+    for (size_t i = 0; i < heapCount; ++i)
+    {
+        C8_Reset(instances[i]);
+        free(instances[i]);
+    }
+    const double heapResetTime = MillisecondsSince(ticksStart);
+
+    // The pool is sized up front, so every instance comes from the same slab and is released in one call.
+    ticksStart = SDL_GetTicksNS();
+    InstancePool pool = CreateInstancePool(&instance, count, true);
+    const double poolSetupTime = MillisecondsSince(ticksStart);
+
+    ticksStart = SDL_GetTicksNS();
+    size_t poolCount = 0;
+    for (; poolCount < count; ++poolCount)
+    {
+        if (!(instances[poolCount] = AcquireInstance(&pool, &instance)))
+            break;
+    }
+    const double poolCreateTime = MillisecondsSince(ticksStart);
+
+    ticksStart = SDL_GetTicksNS();
+    ResetInstancePool(&pool);
+    const double poolResetTime = MillisecondsSince(ticksStart);
+
+    if (heapCount < count || poolCount < count)
+    {
+        fprintf(stderr, "Ran out of memory after %zu heap and %zu pooled instance(s).\n", heapCount, poolCount);
+        result = 1;
+    }
+
+    printf("%s: %zu instance(s) of %zu bytes\n", argv[0], count, pool.slotSize);
+    printf("  heap: create=%.2fms reset=%.2fms\n", heapCreateTime, heapResetTime);
+    printf("  pool: create=%.2fms reset=%.2fms (slab mapped in %.2fms%s)\n",
+        poolCreateTime, poolResetTime, poolSetupTime, pool.arena.isPageMapped ? "" : ", from the C heap");
+
+    FreeInstancePool(&pool);
+    free(instances);
+    C8_Reset(&instance);
+
+    return result;
+}
+
+// Executes a frame's worth of cycles at the default clock rate, then updates the timers.
+static void StepFrame(C8_Instance *instance)
+{
+    for (uint16_t cycle = 0; cycle < DEFAULT_CLOCK_RATE / 60; ++cycle)
+        C8_FetchExecute(instance);
+    C8_UpdateTimers(instance);
+}
+
+// Repeatedly forks [source] into [destination] for FORK_BENCHMARK_SECONDS, stepping the fork a frame each time if [isStepping].
+// Returns the number of forks per second.
+static double MeasureForks(C8_Instance *destination, const C8_Instance *source, const bool isStepping)
+{
+    constexpr uint64_t forksPerCheck = 1024;
+    const uint64_t ticksEnd = SDL_GetTicksNS() + (uint64_t)(FORK_BENCHMARK_SECONDS * 1000000000.0);
+
+    uint64_t forkCount = 0;
+    const uint64_t ticksStart = SDL_GetTicksNS();
+    uint64_t ticksNow = ticksStart;
+    while (ticksNow < ticksEnd)
+    {
+        for (uint64_t i = 0; i < forksPerCheck; ++i)
+        {
+            if (!C8_Fork(destination, source))
+                return 0.0;
+            if (isStepping)
+                StepFrame(destination);
+        }
+        forkCount += forksPerCheck;
+        ticksNow = SDL_GetTicksNS();
+    }
+
+    return (double)forkCount / ((double)(ticksNow - ticksStart) / 1000000000.0);
+}
+
+static int ForkCommand(const int argc, char *argv[])
+{
+    if (argc < 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const long warmUpFrames = argc >= 2 ? strtol(argv[1], nullptr, 10) : DEFAULT_FORK_WARM_UP_FRAMES;
+
+    static C8_Instance source;
+    static C8_Instance destination;
+    source.config = DEFAULT_CONFIG;
+
+    char *error;
+    if (!LoadCommandProgram(&source, argv[0], &error))
+    {
+        fprintf(stderr, "%s: %s\n", argv[0], error);
+        return 1;
+    }
+
+    // Run the program for a while first, so the forked state is representative of one mid-game.
+    for (long frame = 0; frame < warmUpFrames; ++frame)
+        StepFrame(&source);
+
+    const double forksPerSecond = MeasureForks(&destination, &source, false);
+    const double steppedForksPerSecond = MeasureForks(&destination, &source, true);
+
+    int result = 0;
+    if (forksPerSecond == 0.0 || steppedForksPerSecond == 0.0)
+    {
+        fprintf(stderr, "%s: failed to fork.\n", argv[0]);
+        result = 1;
+    }
+    else
+    {
+        printf("%s: fork=%.0f/s fork+step-frame=%.0f/s\n", argv[0], forksPerSecond, steppedForksPerSecond);
+    }
+
+    C8_Reset(&destination);
+    C8_Reset(&source);
+
+    return result;
+}
+
+// Parses a probe written as <format>:<address>[:<length>]. Returns true if the probe is valid; otherwise, false.
+static bool ParseProbe(const char *text, C8_MemoryProbe *probe)
+{
+    static const struct
+    {
+        const char *name;
+        C8_ProbeFormat format;
+    } FORMATS[] = {
+        { "bcd", C8_PROBE_BCD },
+        { "unsigned", C8_PROBE_UNSIGNED },
+        { "register", C8_PROBE_REGISTER }
+    };
+
+    const char *separator = strchr(text, ':');
+    if (!separator)
+        return false;
+
+    size_t format = 0;
+    for (; format < SDL_arraysize(FORMATS); ++format)
+    {
+        if (strlen(FORMATS[format].name) == (size_t)(separator - text) && strncmp(text, FORMATS[format].name, separator - text) == 0)
+            break;
+    }
+    if (format == SDL_arraysize(FORMATS))
+        return false;
+
+    char *end;
+    const unsigned long address = strtoul(separator + 1, &end, 0);
+    if (end == separator + 1 || address > UINT16_MAX)
+        return false;
+
+    unsigned long length = 1;
+    if (*end == ':')
+    {
+        const char *lengthText = end + 1;
+        length = strtoul(lengthText, &end, 0);
+        if (end == lengthText || length == 0 || length > UINT8_MAX)
+            return false;
+    }
+    if (*end != '\0')
+        return false;
+
+    *probe = (C8_MemoryProbe){
+        .format = FORMATS[format].format,
+        .address = (uint16_t)address,
+        .length = (uint8_t)length
+    };
+    return true;
+}
+
+static int SearchCommand(const int argc, char *argv[])
+{
+    C8_SearchOptions options = {
+        .cyclesPerFrame = DEFAULT_CLOCK_RATE / 60,
+        .framesPerStep = SEARCH_FRAMES_PER_STEP,
+        .steps = argc >= 3 ? strtoul(argv[2], nullptr, 10) : DEFAULT_SEARCH_STEPS,
+        .beamWidth = argc >= 4 ? strtoul(argv[3], nullptr, 10) : DEFAULT_BEAM_WIDTH
+    };
+
+    if (argc < 2 || !ParseProbe(argv[1], &options.score) || options.steps == 0 || options.beamWidth == 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    static C8_Instance instance;
+    instance.config = DEFAULT_CONFIG;
+
+    char *error;
+    if (!LoadCommandProgram(&instance, argv[0], &error))
+    {
+        fprintf(stderr, "%s: %s\n", argv[0], error);
+        return 1;
+    }
+
+    JobPool *pool = CreateJobPool(0);
+    uint8_t *trace = malloc(options.steps);
+    if (!pool || !trace)
+    {
+        fprintf(stderr, "Failed to start the search: %s\n", pool ? "out of memory" : SDL_GetError());
+        free(trace);
+        if (pool)
+            FreeJobPool(pool);
+        C8_Reset(&instance);
+        return 1;
+    }
+
+    C8_SearchResult result;
+    const uint64_t ticksStart = SDL_GetTicksNS();
+    const bool isSuccessful = C8_SearchInputs(&instance, options, pool, trace, &result);
+    const double elapsedTime = MillisecondsSince(ticksStart);
+
+    if (isSuccessful)
+    {
+        printf("%s: score=%lld after %u step(s) of %u frame(s) [%.2fms, %.0f states/s]\n",
+            argv[0], (long long)result.score, result.stepCount, options.framesPerStep,
+            elapsedTime, (double)result.statesExpanded / (elapsedTime / 1000.0));
+        printf("  expanded=%llu duplicates=%llu threads=%d\n",
+            (unsigned long long)result.statesExpanded, (unsigned long long)result.duplicateStates, pool->threadCount + 1);
+
+        // Each step is printed as the hexadecimal key held, or '.' if no key was held.
+        printf("  trace: ");
+        for (uint32_t step = 0; step < result.stepCount; ++step)
+            putchar(trace[step] == C8_SEARCH_NO_KEY ? '.' : "0123456789ABCDEF"[trace[step]]);
+        printf("\n");
+    }
+    else
+    {
+        fprintf(stderr, "%s: ran out of memory while searching.\n", argv[0]);
+    }
+
+    free(trace);
+    FreeJobPool(pool);
+    C8_Reset(&instance);
+
+    return isSuccessful ? 0 : 1;
+}
+
+static int EnvironmentCommand(const int argc, char *argv[])
+{
+    C8_EnvironmentOptions options = {
+        .observationFormat = C8_OBSERVATION_BITS,
+        .cyclesPerFrame = DEFAULT_CLOCK_RATE / 60,
+        .frameSkip = ENVIRONMENT_FRAME_SKIP,
+        .stickyActionProbability = ENVIRONMENT_STICKY_ACTION_PROBABILITY
+    };
+
+    const size_t count = argc >= 3 ? strtoull(argv[2], nullptr, 10) : DEFAULT_ENVIRONMENT_COUNT;
+    const uint32_t steps = argc >= 4 ? strtoul(argv[3], nullptr, 10) : DEFAULT_ENVIRONMENT_STEPS;
+
+    if (argc < 2 || !ParseProbe(argv[1], &options.reward) || count == 0 || steps == 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    static C8_Instance instance;
+    instance.config = DEFAULT_CONFIG;
+
+    char *error;
+    if (!LoadCommandProgram(&instance, argv[0], &error))
+    {
+        fprintf(stderr, "%s: %s\n", argv[0], error);
+        return 1;
+    }
+
+    // Every buffer is allocated once up front; stepping writes into them in place.
+    JobPool *pool = CreateJobPool(0);
+    C8_Environment *environments = malloc(count * sizeof(C8_Environment));
+    uint8_t *actions = malloc(count);
+    uint8_t *observations = malloc(count * C8_OBSERVATION_BITS_SIZE);
+    float *rewards = malloc(count * sizeof(float));
+    bool *dones = malloc(count * sizeof(bool));
+
+    int result = 0;
+    if (!pool || !environments || !actions || !observations || !rewards || !dones
+        || !C8_CreateEnvironments(environments, count, &instance, &options, C8_DEFAULT_RANDOM_SEED))
+    {
+        fprintf(stderr, "Failed to create %zu environment(s).\n", count);
+        result = 1;
+    }
+    else
+    {
+        uint32_t random = C8_DEFAULT_RANDOM_SEED;
+        double totalReward = 0.0;
+        uint64_t episodeCount = 0;
+
+        const uint64_t ticksStart = SDL_GetTicksNS();
+        for (uint32_t step = 0; step < steps; ++step)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                actions[i] = C8_NextRandom(&random) % C8_SEARCH_ACTION_COUNT;
+            }
+
+            C8_StepEnvironments(environments, actions, count, &options, pool, observations, rewards, dones);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                totalReward += rewards[i];
+                episodeCount += dones[i];
+            }
+        }
+        const double elapsedTime = MillisecondsSince(ticksStart);
+        const double environmentSteps = (double)count * steps;
+
+        printf("%s: %zu environment(s) x %u step(s) of %u frame(s) [%.2fms]\n",
+            argv[0], count, steps, options.frameSkip, elapsedTime);
+        printf("  %.0f steps/s, %.0f frames/s, %llu episode(s) ended, mean reward %.3f per step\n",
+            environmentSteps / (elapsedTime / 1000.0),
+            environmentSteps * options.frameSkip / (elapsedTime / 1000.0),
+            (unsigned long long)episodeCount, totalReward / environmentSteps);
+
+        C8_FreeEnvironments(environments, count);
+    }
+
+    free(dones);
+    free(rewards);
+    free(observations);
+    free(actions);
+    free(environments);
+    if (pool)
+        FreeJobPool(pool);
+    C8_Reset(&instance);
+
+    return result;
+}
+
+static int RunCommand(const int argc, char *argv[])
+{
+    if (argc < 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const uint32_t seconds = argc >= 2 ? (uint32_t)strtoul(argv[1], nullptr, 10) : DEFAULT_RUN_SECONDS;
+
+    // The timers tick every sixtieth of a second of guest cycles, so the final state doesn't depend on the host.
+    static C8_Instance instance;
+    instance.config = DEFAULT_CONFIG;
+    instance.config.cyclesPerTimerTick = DEFAULT_CLOCK_RATE / 60;
+
+    char *error;
+    if (!LoadCommandProgram(&instance, argv[0], &error))
+    {
+        fprintf(stderr, "%s: %s\n", argv[0], error);
+        return 1;
+    }
+
+    const uint64_t ticksStart = SDL_GetTicksNS();
+    const uint32_t cycleCount = C8_RunCycles(&instance, seconds * DEFAULT_CLOCK_RATE);
+    const double runTime = MillisecondsSince(ticksStart);
+
+    const double guestTime = (double)cycleCount / DEFAULT_CLOCK_RATE * 1000.0;
+    printf("%s: %u cycle(s) in %.2fms (%.0fx real time), status %d, state hash %016llx\n", argv[0],
+        cycleCount, runTime, runTime > 0.0 ? guestTime / runTime : 0.0, instance.status,
+        (unsigned long long)C8_GetStateHash(&instance));
+
+    C8_Reset(&instance);
+
+    return 0;
+}
+
+static void PrintConformanceState(const char *label, const C8_Instance *instance)
+{
+    printf("    %-9s pc=%03X i=%03X sp=%u dt=%u st=%u status=%d cycle=%llu hash=%016llx\n              v=",
+        label, instance->pc, instance->i, instance->sp, instance->dt, instance->st, instance->status,
+        (unsigned long long)instance->cycleCount, (unsigned long long)C8_GetStateHash(instance));
+    for (int i = 0; i < 16; ++i)
+        printf("%02X%c", instance->v[i], i == 15 ? '\n' : ' ');
+}
+
+// Prints where the memory of two diverged states first differs, as the registers alone may match.
+static void PrintMemoryDifferences(const C8_Instance *reference, const C8_Instance *candidate)
+{
+    for (uint32_t address = 0; address < reference->heapSize && address < candidate->heapSize; ++address)
+    {
+        if (C8_ReadHeap(reference, address) != C8_ReadHeap(candidate, address))
+        {
+            printf("    heap differs first at %04X: %02X vs %02X\n", address, C8_ReadHeap(reference, address), C8_ReadHeap(candidate, address));
+            break;
+        }
+    }
+
+    const size_t words = C8_GetFramebufferSize(reference) / sizeof(uint64_t);
+    for (size_t word = 0; word < words && C8_GetFramebufferSize(reference) == C8_GetFramebufferSize(candidate); ++word)
+    {
+        if (reference->framebuffer[word] != candidate->framebuffer[word])
+        {
+            printf("    framebuffer differs first in row %zu of plane %zu\n",
+                word / reference->displayRowWords % SUPER_CHIP_DISPLAY_HEIGHT, word / reference->displayRowWords / SUPER_CHIP_DISPLAY_HEIGHT);
+            break;
+        }
+    }
+}
+
+static int ConformCommand(const int argc, char *argv[])
+{
+    if (argc < 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    JobPool *pool = CreateJobPool(0);
+    C8_Instance *initials = calloc((size_t)argc * C8_QUIRK_COMBINATIONS, sizeof(C8_Instance));
+    C8_ConformanceResult *results = calloc((size_t)argc * C8_QUIRK_COMBINATIONS, sizeof(C8_ConformanceResult));
+    if (!pool || !initials || !results)
+    {
+        fprintf(stderr, "Failed to allocate memory.\n");
+        free(results);
+        free(initials);
+        if (pool)
+            FreeJobPool(pool);
+        return 1;
+    }
+
+    static C8_Instance instance;
+    static C8_Analysis analysis;
+    int result = 0;
+
+    // Each program is run from its initial state under every quirk configuration, on the platform the analyzer suggests.
+    for (int i = 0; i < argc; ++i)
+    {
+        C8_Reset(&instance);
+        instance.config = DEFAULT_CONFIG;
+
+        char *error;
+        if (!C8_LoadProgramFileDetected(&instance, argv[i], &analysis, &error))
+        {
+            fprintf(stderr, "%s: %s\n", argv[i], error);
+            result = 1;
+            continue;
+        }
+
+        for (size_t combination = 0; combination < C8_QUIRK_COMBINATIONS; ++combination)
+        {
+            C8_Instance *initial = &initials[(size_t)i * C8_QUIRK_COMBINATIONS + combination];
+            if (!C8_CopyInstance(initial, &instance))
+                continue;
+
+            initial->config.useParameterisedShift = combination & 0x1;
+            initial->config.useParameterisedJump = combination & 0x2;
+            initial->config.useTemporaryIndex = combination & 0x4;
+            initial->config.cyclesPerTimerTick = DEFAULT_CLOCK_RATE / 60;
+        }
+    }
+
+    // C8_RunCycles is the only engine besides the reference; faster engines are checked by passing them here instead.
+    const C8_ConformanceOptions options = {
+        .engine = C8_RunCycles,
+        .cycleCount = CONFORMANCE_SECONDS * DEFAULT_CLOCK_RATE,
+        .checkInterval = CONFORMANCE_CHECK_INTERVAL,
+        .inputSeed = CONFORMANCE_INPUT_SEED
+    };
+
+    const uint64_t ticksStart = SDL_GetTicksNS();
+    if (!C8_CheckConformance(initials, (size_t)argc * C8_QUIRK_COMBINATIONS, options, pool, results))
+    {
+        fprintf(stderr, "Ran out of memory while checking conformance.\n");
+        result = 1;
+    }
+    const double checkTime = MillisecondsSince(ticksStart);
+
+    int divergedCount = 0;
+    for (size_t j = 0; j < (size_t)argc * C8_QUIRK_COMBINATIONS; ++j)
+    {
+        const C8_Instance *initial = &initials[j];
+        const C8_ConformanceResult *run = &results[j];
+        if (!initial->heapPages)
+            continue;
+
+        printf("%s: shift=%-3s jump=%-3s index=%-3s ", argv[j / C8_QUIRK_COMBINATIONS],
+            initial->config.useParameterisedShift ? "on" : "off",
+            initial->config.useParameterisedJump ? "on" : "off",
+            initial->config.useTemporaryIndex ? "on" : "off");
+
+        if (!run->hasDiverged)
+        {
+            printf("matched for %llu cycle(s)\n", (unsigned long long)run->cycleCount);
+            continue;
+        }
+
+        ++divergedCount;
+        printf("diverged after %llu cycle(s), executing %04X at %03X\n", (unsigned long long)run->cycleCount, run->opcode, run->pc);
+        PrintConformanceState("reference", &run->reference);
+        PrintConformanceState("candidate", &run->candidate);
+        PrintMemoryDifferences(&run->reference, &run->candidate);
+    }
+
+    printf("%d of %d run(s) diverged [%.2fms]\n", divergedCount, argc * C8_QUIRK_COMBINATIONS, checkTime);
+    if (divergedCount > 0)
+        result = 1;
+
+    C8_FreeConformanceResults(results, (size_t)argc * C8_QUIRK_COMBINATIONS);
+    for (size_t j = 0; j < (size_t)argc * C8_QUIRK_COMBINATIONS; ++j)
+        C8_Reset(&initials[j]);
+    C8_Reset(&instance);
+    free(results);
+    free(initials);
+    FreeJobPool(pool);
+
+    return result;
+}
+
+static int ReplayCommand(const int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    static C8_Movie movie;
+    char *error;
+    if (!C8_LoadMovie(&movie, argv[1], &error))
+    {
+        fprintf(stderr, "%s: %s\n", argv[1], error);
+        C8_FreeMovie(&movie);
+        return 1;
+    }
+
+    static C8_Instance instance;
+    instance.config = movie.config;
+    if (!C8_LoadProgram(&instance, argv[0], &error))
+    {
+        fprintf(stderr, "%s: %s\n", argv[0], error);
+        C8_FreeMovie(&movie);
+        return 1;
+    }
+
+    int result = 0;
+    C8_MoviePlayer player;
+    if (C8_BeginReplay(&player, &instance, &movie))
+    {
+        const uint64_t ticksStart = SDL_GetTicksNS();
+        while (C8_ReplayFrame(&player, &instance) == C8_REPLAY_PLAYING)
+            continue;
+        const double replayTime = MillisecondsSince(ticksStart);
+
+        // Frames are recorded at 60Hz, so the recorded session lasted a sixtieth of a second per frame.
+        const double sessionTime = (double)player.frameCount / 60.0 * 1000.0;
+        printf("%s: %llu frame(s), %llu cycle(s) in %.2fms (%.0fx real time)\n", argv[1],
+            (unsigned long long)player.frameCount, (unsigned long long)instance.cycleCount, replayTime,
+            replayTime > 0.0 ? sessionTime / replayTime : 0.0);
+
+        if (player.status == C8_REPLAY_DIVERGED)
+        {
+            fprintf(stderr, "Diverged from the recording at frame %llu (cycle %llu).\n",
+                (unsigned long long)player.frameCount, (unsigned long long)instance.cycleCount);
+            result = 1;
+        }
+    }
+    else
+    {
+        fprintf(stderr, "%s was not recorded from %s.\n", argv[1], argv[0]);
+        result = 1;
+    }
+
+    C8_FreeMovie(&movie);
+    C8_Reset(&instance);
+
+    return result;
+}
+
+static int ServeCommand(const int argc, char *argv[])
+{
+    if (argc < 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // Frames only advance when a script steps them, so the program is never run in real time.
+    static C8VM virtualMachine;
+    virtualMachine.cyclesPerSecond = DEFAULT_CLOCK_RATE;
+    virtualMachine.autoDetectQuirks = true;
+    virtualMachine.config = DEFAULT_CONFIG;
+    virtualMachine.instance.config = DEFAULT_CONFIG;
+
+    char *error;
+    if (argc >= 2 && !C8_LoadProgram(&virtualMachine.instance, argv[1], &error))
+    {
+        fprintf(stderr, "%s: %s\n", argv[1], error);
+        return 1;
+    }
+
+    static ControlServer server;
+    if (!CreateControlServer(&server, argv[0]))
+    {
+        fprintf(stderr, "CreateControlServer failed: %s\n", SDL_GetError());
+        C8_Reset(&virtualMachine.instance);
+        return 1;
+    }
+
+    printf("Listening on %s\n", argv[0]);
+    fflush(stdout);
+
+    while (!(PollControlServer(&server, &virtualMachine) & CONTROL_EVENT_QUIT_REQUESTED))
+        WaitForControlServer(&server, -1);
+
+    FreeControlServer(&server);
+    SDL_free(virtualMachine.programPath);
+    C8_Reset(&virtualMachine.instance);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 3 && strcmp(argv[1], "--platform") == 0)
+    {
+        if (!ParsePlatform(argv[2], &selectedPlatform))
+        {
+            fprintf(stderr, "Unknown platform: %s\n", argv[2]);
+            PrintUsage();
+            return 1;
+        }
+
+        isPlatformSelected = true;
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (strcmp(argv[1], "analyze") == 0)
+        return AnalyzeCommand(argc - 2, argv + 2);
+
+    if (strcmp(argv[1], "detect") == 0)
+        return DetectCommand(argc - 2, argv + 2);
+
+    if (strcmp(argv[1], "pool") == 0)
+        return PoolCommand(argc - 2, argv + 2);
+
+    if (strcmp(argv[1], "fork") == 0)
+        return ForkCommand(argc - 2, argv + 2);
+
+    if (strcmp(argv[1], "search") == 0)
+        return SearchCommand(argc - 2, argv + 2);
+
+    if (strcmp(argv[1], "env") == 0)
+        return EnvironmentCommand(argc - 2, argv + 2);
+
+    if (strcmp(argv[1], "serve") == 0)
+        return ServeCommand(argc - 2, argv + 2);
+
+    if (strcmp(argv[1], "run") == 0)
+        return RunCommand(argc - 2, argv + 2);
+
+    if (strcmp(argv[1], "conform") == 0)
+        return ConformCommand(argc - 2, argv + 2);
+
+    if (strcmp(argv[1], "replay") == 0)
+        return ReplayCommand(argc - 2, argv + 2);
+
+    PrintUsage();
+    return 1;
+}
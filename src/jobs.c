@@ -0,0 +1,117 @@
+#include "jobs.h"
+
+// Executes jobs from the [pool] until none remain.
+static void RunAvailableJobs(JobPool *pool)
+{
+    while (true)
+    {
+        const size_t jobIndex = (size_t)SDL_AddAtomicInt(&pool->nextJob, 1);
+        if (jobIndex >= pool->jobCount)
+            return;
+        pool->function(pool->userData, jobIndex);
+    }
+}
+
+static int JobPool_WorkerThread(void *data)
+{
+    JobPool *pool = data;
+    uint64_t generation = 0;
+
+    SDL_LockMutex(pool->mutex);
+    while (true)
+    {
+        while (pool->generation == generation && !pool->isShuttingDown)
+            SDL_WaitCondition(pool->workAvailable, pool->mutex);
+
+        if (pool->isShuttingDown)
+            break;
+
+        generation = pool->generation;
+        SDL_UnlockMutex(pool->mutex);
+
+        RunAvailableJobs(pool);
+
+        SDL_LockMutex(pool->mutex);
+        if (--pool->activeWorkers == 0)
+            SDL_SignalCondition(pool->workFinished);
+    }
+    SDL_UnlockMutex(pool->mutex);
+
+    return 0;
+}
+
+JobPool *CreateJobPool(int threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = SDL_max(SDL_GetNumLogicalCPUCores() - 1, 0);
+
+    JobPool *pool = SDL_calloc(1, sizeof(JobPool));
+    if (!pool)
+        return nullptr;
+
+    pool->mutex = SDL_CreateMutex();
+    pool->workAvailable = SDL_CreateCondition();
+    pool->workFinished = SDL_CreateCondition();
+    pool->threads = SDL_calloc(SDL_max(threadCount, 1), sizeof(SDL_Thread *));
+    if (!pool->mutex || !pool->workAvailable || !pool->workFinished || !pool->threads)
+    {
+        FreeJobPool(pool);
+        return nullptr;
+    }
+
+    for (int i = 0; i < threadCount; ++i)
+    {
+        pool->threads[i] = SDL_CreateThread(JobPool_WorkerThread, "C8VM Worker", pool);
+        if (!pool->threads[i])
+            break;
+        ++pool->threadCount;
+    }
+
+    return pool;
+}
+
+void RunJobsOnPool(JobPool *pool, const size_t jobCount, const JobFunction function, void *userData)
+{
+    if (jobCount == 0)
+        return;
+
+    SDL_LockMutex(pool->mutex);
+    pool->function = function;
+    pool->userData = userData;
+    pool->jobCount = jobCount;
+    SDL_SetAtomicInt(&pool->nextJob, 0);
+    pool->activeWorkers = pool->threadCount;
+    ++pool->generation;
+    SDL_BroadcastCondition(pool->workAvailable);
+    SDL_UnlockMutex(pool->mutex);
+
+    RunAvailableJobs(pool);
+
+    SDL_LockMutex(pool->mutex);
+    while (pool->activeWorkers > 0)
+        SDL_WaitCondition(pool->workFinished, pool->mutex);
+    SDL_UnlockMutex(pool->mutex);
+}
+
+void FreeJobPool(JobPool *pool)
+{
+    if (!pool)
+        return;
+
+    if (pool->mutex)
+    {
+        SDL_LockMutex(pool->mutex);
+        pool->isShuttingDown = true;
+        SDL_BroadcastCondition(pool->workAvailable);
+        SDL_UnlockMutex(pool->mutex);
+    }
+
+    for (int i = 0; i < pool->threadCount; ++i)
+        SDL_WaitThread(pool->threads[i], nullptr);
+
+    SDL_free(pool->threads);
+    SDL_DestroyCondition(pool->workFinished);
+    SDL_DestroyCondition(pool->workAvailable);
+    SDL_DestroyMutex(pool->mutex);
+    SDL_free(pool);
+}
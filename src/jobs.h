@@ -0,0 +1,42 @@
+#ifndef C8VM_JOBS_H
+#define C8VM_JOBS_H
+
+#include <stdint.h>
+
+#include <SDL3/SDL.h>
+
+// A function executed once for each job index in the range [0, jobCount).
+typedef void (*JobFunction)(void *userData, size_t jobIndex);
+
+// A fixed set of worker threads that jobs can be distributed across.
+typedef struct
+{
+    SDL_Thread **threads;
+    int threadCount;
+
+    SDL_Mutex *mutex;
+    SDL_Condition *workAvailable;
+    SDL_Condition *workFinished;
+
+    JobFunction function;
+    void *userData;
+    size_t jobCount;
+    SDL_AtomicInt nextJob;
+
+    uint64_t generation;
+    int activeWorkers;
+    bool isShuttingDown;
+} JobPool;
+
+// Creates a new [JobPool] with [threadCount] worker threads.
+// If [threadCount] is zero, one worker thread is created for each logical CPU core other than the calling thread's.
+JobPool *CreateJobPool(int threadCount);
+
+// Executes [function] once for each index in the range [0, jobCount), distributing the jobs across the [pool]'s
+// worker threads and the calling thread. Returns once all jobs have completed.
+void RunJobsOnPool(JobPool *pool, size_t jobCount, JobFunction function, void *userData);
+
+// Stops and joins all worker threads held by the [pool], and frees the [pool].
+void FreeJobPool(JobPool *pool);
+
+#endif // C8VM_JOBS_H
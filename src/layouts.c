@@ -1,18 +1,31 @@
 #include <SDL3/SDL.h>
 
+#include "analyzer.h"
 #include "components.h"
+#include "detector.h"
 #include "layouts.h"
 
 #include <stdio.h>
 
+// The number of seconds each quirk configuration is simulated for when the static analyzer is inconclusive.
+static constexpr uint16_t QUIRK_DETECTION_SECONDS = 3;
+
+static const Clay_String PLATFORM_NAMES[] = {
+    [C8_PLATFORM_CHIP_8] = CLAY_STRING_CONST("CHIP-8"),
+    [C8_PLATFORM_SUPER_CHIP] = CLAY_STRING_CONST("SUPER-CHIP"),
+    [C8_PLATFORM_XO_CHIP] = CLAY_STRING_CONST("XO-CHIP")
+};
+
 static constexpr Clay_Color COLOR_BACKGROUND_PRIMARY = { 10, 10, 10, 255 };
 static constexpr Clay_Color COLOR_BACKGROUND_SEMI_TRANSPARENT = { 0, 0, 0, 230 };
 static constexpr Clay_Color COLOR_FOREGROUND_PRIMARY = { 245, 245, 245, 255 };
 
+// The type of the event posted when a program is selected in the file dialog, registered when the dialog is first shown.
+static Uint32 programSelectedEventType;
+
+// May be called on another thread, so the selected path is posted to the main thread rather than loaded here.
 static void SelectLayout_OpenFileDialogCallback(void *userdata, const char * const *filelist, int filter)
 {
-    const LayoutData *data = userdata;
-
     if (!filelist)
     {
         SDL_LogError(SDL_LOG_CATEGORY_ERROR, "SDL_ShowOpenFileDialog failed: %s\n", SDL_GetError());
@@ -23,22 +36,71 @@ static void SelectLayout_OpenFileDialogCallback(void *userdata, const char * con
     if (!*filelist)
         return;
 
+    SDL_Event event = { .type = programSelectedEventType };
+    event.user.data1 = SDL_strdup(filelist[0]);
+    event.user.data2 = userdata;
+    if (!event.user.data1 || !SDL_PushEvent(&event))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "SDL_PushEvent failed: %s\n", SDL_GetError());
+        SDL_free(event.user.data1);
+    }
+}
+
+static void SelectLayout_LoadProgram(const LayoutData *data, const char *path)
+{
+    data->virtualMachine->isReplayingMovie = false;
+    data->virtualMachine->instance.config = data->virtualMachine->config;
+
     char *error;
-    if (!C8_LoadProgram(&data->virtualMachine->instance, filelist[0], &error))
+    if (!data->virtualMachine->autoDetectQuirks)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "C8_LoadProgram failed: %s\n", error);
-        return;
+        if (!C8_LoadProgram(&data->virtualMachine->instance, path, &error))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "C8_LoadProgram failed: %s\n", error);
+            return;
+        }
+    }
+    else
+    {
+        C8_Analysis analysis;
+        if (!C8_LoadProgramFileDetected(&data->virtualMachine->instance, path, &analysis, &error))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "C8_LoadProgramFileDetected failed: %s\n", error);
+            return;
+        }
+
+        if (!C8_IsQuirkSettled(analysis.parameterisedShift) || !C8_IsQuirkSettled(analysis.parameterisedJump) || !C8_IsQuirkSettled(analysis.temporaryIndex))
+        {
+            C8_QuirkDetection detection;
+            C8_DetectQuirks(&data->virtualMachine->instance, (C8_DetectionOptions){
+                .cyclesPerSecond = data->virtualMachine->cyclesPerSecond,
+                .seconds = QUIRK_DETECTION_SECONDS
+            }, data->jobPool, &detection);
+            data->virtualMachine->instance.config = detection.config;
+        }
     }
 
+    if (data->virtualMachine->isRecordingMovie)
+        C8_BeginMovie(&data->virtualMachine->movie, &data->virtualMachine->instance);
+
     if (data->virtualMachine->programPath)
         SDL_free(data->virtualMachine->programPath);
-    data->virtualMachine->programPath = SDL_strdup(filelist[0]);
+    data->virtualMachine->programPath = SDL_strdup(path);
     data->virtualMachine->isRunning = true;
     *data->layout = LAYOUT_MAIN;
 }
 
 static void SelectLayout_OnSelectProgramPressed(void *pressedData)
 {
+    if (!programSelectedEventType)
+        programSelectedEventType = SDL_RegisterEvents(1);
+
+    if (!programSelectedEventType)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "SDL_RegisterEvents failed: %s\n", SDL_GetError());
+        return;
+    }
+
     SDL_ShowOpenFileDialog(SelectLayout_OpenFileDialogCallback, pressedData, nullptr, nullptr, 0, nullptr, false);
 }
 
@@ -65,6 +127,16 @@ static void SelectLayout_OnExitPressed(void *pressedData)
     exit(0);
 }
 
+bool SelectLayout_HandleEvent(const SDL_Event *event)
+{
+    if (!programSelectedEventType || event->type != programSelectedEventType)
+        return false;
+
+    SelectLayout_LoadProgram(event->user.data2, event->user.data1);
+    SDL_free(event->user.data1);
+    return true;
+}
+
 Clay_RenderCommandArray SelectLayout_CreateLayout(LayoutData *data) {
     ResetArena(data->frameArena);
 
@@ -204,31 +276,60 @@ Clay_RenderCommandArray SelectLayout_CreateLayout(LayoutData *data) {
 static void SettingsLayout_OnShiftInPlaceToggled(void *toggledData)
 {
     const LayoutData *data = toggledData;
-    data->virtualMachine->instance.config.useParameterisedShift = !data->virtualMachine->instance.config.useParameterisedShift;
+    data->virtualMachine->config.useParameterisedShift = !data->virtualMachine->config.useParameterisedShift;
 }
 
 static void SettingsLayout_OnUseParameterisedJumpToggled(void *toggledData)
 {
     const LayoutData *data = toggledData;
-    data->virtualMachine->instance.config.useParameterisedJump = !data->virtualMachine->instance.config.useParameterisedJump;
+    data->virtualMachine->config.useParameterisedJump = !data->virtualMachine->config.useParameterisedJump;
 }
 
 static void SettingsLayout_OnUseTemporaryIndexToggled(void *toggledData)
 {
     const LayoutData *data = toggledData;
-    data->virtualMachine->instance.config.useTemporaryIndex = !data->virtualMachine->instance.config.useTemporaryIndex;
+    data->virtualMachine->config.useTemporaryIndex = !data->virtualMachine->config.useTemporaryIndex;
+}
+
+static void SettingsLayout_OnAutoDetectQuirksToggled(void *toggledData)
+{
+    const LayoutData *data = toggledData;
+    data->virtualMachine->autoDetectQuirks = !data->virtualMachine->autoDetectQuirks;
+}
+
+static void SettingsLayout_OnPreviousPlatformPressed(void *pressedData)
+{
+    const LayoutData *data = pressedData;
+    constexpr int platformCount = sizeof(PLATFORM_NAMES) / sizeof(*PLATFORM_NAMES);
+    data->virtualMachine->config.platform = (data->virtualMachine->config.platform + platformCount - 1) % platformCount;
+}
+
+static void SettingsLayout_OnNextPlatformPressed(void *pressedData)
+{
+    const LayoutData *data = pressedData;
+    constexpr int platformCount = sizeof(PLATFORM_NAMES) / sizeof(*PLATFORM_NAMES);
+    data->virtualMachine->config.platform = (data->virtualMachine->config.platform + 1) % platformCount;
+}
+
+// Keeps guest timers, if enabled, ticking at 60Hz of the clock rate.
+static void SettingsLayout_UpdateTimerTick(const LayoutData *data)
+{
+    if (data->virtualMachine->config.cyclesPerTimerTick)
+        data->virtualMachine->config.cyclesPerTimerTick = data->virtualMachine->cyclesPerSecond / 60;
 }
 
 static void SettingsLayout_OnIncreaseCyclesPressed(void *toggledData)
 {
     const LayoutData *data = toggledData;
     data->virtualMachine->cyclesPerSecond = SDL_min(1000, data->virtualMachine->cyclesPerSecond + 100);
+    SettingsLayout_UpdateTimerTick(data);
 }
 
 static void SettingsLayout_OnDecreaseCyclesPressed(void *toggledData)
 {
     const LayoutData *data = toggledData;
     data->virtualMachine->cyclesPerSecond = SDL_max(100, data->virtualMachine->cyclesPerSecond - 100);
+    SettingsLayout_UpdateTimerTick(data);
 }
 
 static void SettingsLayout_OnBackPressed(void *pressedData)
@@ -302,7 +403,7 @@ Clay_RenderCommandArray SettingsLayout_CreateLayout(LayoutData *data)
         }) {
             CheckButton((CheckButtonData){
                 .frameArena = data->frameArena,
-                .isChecked = data->virtualMachine->instance.config.useParameterisedShift,
+                .isChecked = data->virtualMachine->config.useParameterisedShift,
                 .label = CLAY_STRING("Use Parameterised Shift"),
                 .onToggled = SettingsLayout_OnShiftInPlaceToggled,
                 .toggledData = data
@@ -310,7 +411,7 @@ Clay_RenderCommandArray SettingsLayout_CreateLayout(LayoutData *data)
 
             CheckButton((CheckButtonData){
                 .frameArena = data->frameArena,
-                .isChecked = data->virtualMachine->instance.config.useParameterisedJump,
+                .isChecked = data->virtualMachine->config.useParameterisedJump,
                 .label = CLAY_STRING("Use Parameterised Jump"),
                 .onToggled = SettingsLayout_OnUseParameterisedJumpToggled,
                 .toggledData = data
@@ -318,11 +419,19 @@ Clay_RenderCommandArray SettingsLayout_CreateLayout(LayoutData *data)
 
             CheckButton((CheckButtonData){
                 .frameArena = data->frameArena,
-                .isChecked = data->virtualMachine->instance.config.useTemporaryIndex,
+                .isChecked = data->virtualMachine->config.useTemporaryIndex,
                 .label = CLAY_STRING("Use Temporary Index"),
                 .onToggled = SettingsLayout_OnUseTemporaryIndexToggled,
                 .toggledData = data
             });
+
+            CheckButton((CheckButtonData){
+                .frameArena = data->frameArena,
+                .isChecked = data->virtualMachine->autoDetectQuirks,
+                .label = CLAY_STRING("Auto-detect Quirks on Load"),
+                .onToggled = SettingsLayout_OnAutoDetectQuirksToggled,
+                .toggledData = data
+            });
         }
 
         CLAY({
@@ -340,7 +449,7 @@ Clay_RenderCommandArray SettingsLayout_CreateLayout(LayoutData *data)
                 }
             }) {
                 CLAY_TEXT(
-                    CLAY_STRING("Clock Rate"),
+                    CLAY_STRING("Platform"),
                     CLAY_TEXT_CONFIG({
                         .fontId = FONT_PIXELOID_SANS_16PT,
                         .fontSize = 16,
@@ -348,9 +457,9 @@ Clay_RenderCommandArray SettingsLayout_CreateLayout(LayoutData *data)
                     }));
 
                 TextTooltip((TextTooltipData){
-                    .elementId = CLAY_ID("ClockRate"),
+                    .elementId = CLAY_ID("Platform"),
                     .text = CLAY_STRING("(?)"),
-                    .content = CLAY_STRING("Determines how many CHIP-8 instructions are executed per second.\nSome programs may require a different clock rate, but 600Hz should be suitable in most cases.\nNote: the virtual machine will attempt to run at this speed, but the actual clock rate may vary."),
+                    .content = CLAY_STRING("Determines which instruction set the virtual machine implements.\nSUPER-CHIP adds a 128x64 high-resolution display, scrolling, large sprites and fonts, and flag registers.\nXO-CHIP adds 64KiB of memory, a second bitplane and programmable audio."),
                     .offset = {
                         .x = 0.0f,
                         .y = -140.0f
@@ -370,28 +479,97 @@ Clay_RenderCommandArray SettingsLayout_CreateLayout(LayoutData *data)
                 TextButton((TextButtonData){
                     .frameArena = data->frameArena,
                     .text = CLAY_STRING("<"),
-                    .onPressed = SettingsLayout_OnDecreaseCyclesPressed,
+                    .onPressed = SettingsLayout_OnPreviousPlatformPressed,
                     .pressedData = data
                 });
 
-                // Maximum cycle count = 1000 (4 chars + 1 null terminator)
-                char *cycleText = RequestAllocationFromArena(data->frameArena, sizeof(char) * 5);
-                sprintf_s(cycleText, sizeof(char) * 5, "%d", data->virtualMachine->cyclesPerSecond);
+                CLAY_TEXT(
+                    PLATFORM_NAMES[data->virtualMachine->config.platform],
+                    CLAY_TEXT_CONFIG({
+                        .fontId = FONT_PIXELOID_SANS_16PT,
+                        .fontSize = 16,
+                        .textColor = COLOR_FOREGROUND_PRIMARY
+                    }));
 
-                const Clay_String crString = {
-                    .chars = cycleText,
-                    .length = (int32_t)strlen(cycleText),
-                    .isStaticallyAllocated = false
-                };
+                TextButton((TextButtonData){
+                    .frameArena = data->frameArena,
+                    .text = CLAY_STRING(">"),
+                    .onPressed = SettingsLayout_OnNextPlatformPressed,
+                    .pressedData = data
+                });
+            }
+        }
 
+        CLAY({
+            .layout = {
+                .childAlignment = {
+                    .x = CLAY_ALIGN_X_CENTER,
+                    .y = CLAY_ALIGN_Y_CENTER
+                },
+                .childGap = 32
+            }
+        }) {
+            CLAY({
+                .layout = {
+                    .childGap = 8
+                }
+            }) {
                 CLAY_TEXT(
-                    crString,
+                    CLAY_STRING("Clock Rate"),
                     CLAY_TEXT_CONFIG({
                         .fontId = FONT_PIXELOID_SANS_16PT,
                         .fontSize = 16,
                         .textColor = COLOR_FOREGROUND_PRIMARY
                     }));
 
+                TextTooltip((TextTooltipData){
+                    .elementId = CLAY_ID("ClockRate"),
+                    .text = CLAY_STRING("(?)"),
+                    .content = CLAY_STRING("Determines how many CHIP-8 instructions are executed per second.\nSome programs may require a different clock rate, but 600Hz should be suitable in most cases.\nNote: the virtual machine will attempt to run at this speed, but the actual clock rate may vary."),
+                    .offset = {
+                        .x = 0.0f,
+                        .y = -140.0f
+                    }
+                });
+            }
+
+            CLAY({
+                .layout = {
+                    .childAlignment = {
+                        .x = CLAY_ALIGN_X_CENTER,
+                        .y = CLAY_ALIGN_Y_CENTER
+                    },
+                    .childGap = 16
+                }
+            }) {
+                TextButton((TextButtonData){
+                    .frameArena = data->frameArena,
+                    .text = CLAY_STRING("<"),
+                    .onPressed = SettingsLayout_OnDecreaseCyclesPressed,
+                    .pressedData = data
+                });
+
+                // Maximum cycle count = 1000 (4 chars + 1 null terminator)
+                char *cycleText = RequestAllocationFromArena(data->frameArena, sizeof(char) * 5);
+                if (cycleText)
+                {
+                    sprintf_s(cycleText, sizeof(char) * 5, "%d", data->virtualMachine->cyclesPerSecond);
+
+                    const Clay_String crString = {
+                        .chars = cycleText,
+                        .length = (int32_t)strlen(cycleText),
+                        .isStaticallyAllocated = false
+                    };
+
+                    CLAY_TEXT(
+                        crString,
+                        CLAY_TEXT_CONFIG({
+                            .fontId = FONT_PIXELOID_SANS_16PT,
+                            .fontSize = 16,
+                            .textColor = COLOR_FOREGROUND_PRIMARY
+                        }));
+                }
+
                 TextButton((TextButtonData){
                     .frameArena = data->frameArena,
                     .text = CLAY_STRING(">"),
@@ -588,6 +766,7 @@ static void MainLayout_OnResumePressed(void *pressedData)
 static void MainLayout_OnRestartPressed(void *pressedData)
 {
     const LayoutData *data = pressedData;
+    data->virtualMachine->isReplayingMovie = false;
     C8_Reset(&data->virtualMachine->instance);
     char *error;
     if (!C8_LoadProgram(&data->virtualMachine->instance, data->virtualMachine->programPath, &error))
@@ -595,6 +774,9 @@ static void MainLayout_OnRestartPressed(void *pressedData)
         SDL_LogError(SDL_LOG_CATEGORY_ERROR, "C8_LoadProgram failed: %s\n", error);
         return;
     }
+
+    if (data->virtualMachine->isRecordingMovie)
+        C8_BeginMovie(&data->virtualMachine->movie, &data->virtualMachine->instance);
     data->virtualMachine->isRunning = true;
 }
 
@@ -602,6 +784,7 @@ static void MainLayout_OnExitPressed(void *pressedData)
 {
     const LayoutData *data = pressedData;
     data->virtualMachine->isRunning = false;
+    data->virtualMachine->isReplayingMovie = false;
     C8_Reset(&data->virtualMachine->instance);
     *data->layout = LAYOUT_SELECT;
 }
@@ -5,6 +5,7 @@
 #include "arena.h"
 #include "core.h"
 #include "clay.h"
+#include "jobs.h"
 
 typedef enum
 {
@@ -18,10 +19,15 @@ typedef enum
 typedef struct
 {
     Arena *frameArena;
+    JobPool *jobPool;
     Layout *layout;
     C8VM *virtualMachine;
 } LayoutData;
 
+// Loads the program selected in the file dialog, whose path is posted as an event because the dialog's callback may
+// run on another thread. Returns true if the event was handled; otherwise, false.
+bool SelectLayout_HandleEvent(const SDL_Event *event);
+
 Clay_RenderCommandArray SelectLayout_CreateLayout(LayoutData *data);
 Clay_RenderCommandArray SettingsLayout_CreateLayout(LayoutData *data);
 Clay_RenderCommandArray ControlsLayout_CreateLayout(LayoutData *data);
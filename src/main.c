@@ -3,14 +3,19 @@
 #define SDL_MAIN_USE_CALLBACKS
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
+#ifndef C8VM_USE_GLYPH_ATLAS
 #include <SDL3_ttf/SDL_ttf.h>
+#endif
 
 #define CLAY_IMPLEMENTATION
 #include "clay.h"
 #include "clay_renderer_SDL3.c"
 
 #include "arena.h"
+#include "control.h"
 #include "core.h"
+#include "frame_export.h"
+#include "jobs.h"
 #include "layouts.h"
 
 static constexpr char WINDOW_TITLE[]     = "C8VM";
@@ -18,14 +23,32 @@ static constexpr int  WINDOW_WIDTH       = 1280;
 static constexpr int  WINDOW_HEIGHT      = 720;
 static constexpr int  DEFAULT_CLOCK_RATE = 600;
 
+static constexpr Uint64 TICKS_PER_SECOND      = 1000000000;
+static constexpr Uint64 TICKS_PER_MILLISECOND = 1000000;
+static constexpr Uint64 TICKS_PER_FRAME       = TICKS_PER_SECOND / 60;
+
+// The number of frames drawn with and without the geometry cache by --benchmark-settings, unless another is given.
+static constexpr int DEFAULT_BENCHMARK_FRAMES = 500;
+
+// The number of each shape timed per benchmark frame when timing shapes on their own.
+static constexpr int BENCHMARK_SHAPES_PER_FRAME = 100;
+
+// Cycles are executed in batches no more frequently than this, so fast clock rates don't wake the loop for every cycle.
+static constexpr Uint64 MINIMUM_TICKS_PER_CYCLE_BATCH = TICKS_PER_MILLISECOND;
+
 typedef struct
 {
     uint64_t iterationsPerSecond;
     uint64_t cyclesPerSecond;
     uint64_t framesPerSecond;
+    uint64_t drawsPerSecond;
     uint64_t ticksLastIteration;
     uint64_t ticksLastCycle;
     uint64_t ticksLastFrame;
+    uint64_t wakeUpsPerSecond;
+    uint64_t wakeUpJitterTotal;
+    uint64_t wakeUpJitterMax;
+    uint64_t layoutTicksTotal;
 } PerformanceMetrics;
 
 typedef struct
@@ -36,24 +59,40 @@ typedef struct
     Clay_SDL3RendererData rendererData;
 
     SDL_AudioStream *audioStream;
-    int currentAudioSample;
+    float audioPatternPosition;
+
+    // The audio pattern and its playback rate as of the last frame, copied while holding the audio stream's lock, as
+    // the audio callback runs on another thread and must not read the instance while it executes.
+    uint8_t audioPattern[XO_CHIP_AUDIO_PATTERN_SIZE];
+    float audioPlaybackRate;
 
     Arena frameArena;
+    JobPool *jobPool;
     Layout layout;
     LayoutData layoutData;
 
     PerformanceMetrics metrics;
-} AppState;
 
-Clay_Dimensions SDL_MeasureText(const Clay_StringSlice text, Clay_TextElementConfig *config, void *userData)
-{
-    int width, height;
-    TTF_Font **fonts = userData;
-    TTF_Font *font = fonts[config->fontId];
-    TTF_SetFontSize(font, config->fontSize);
-    TTF_GetStringSize(font, text.chars, text.length, &width, &height);
-    return (Clay_Dimensions){ (float)width, (float)height };
-}
+    // Publishes each frame to shared memory for other processes, if enabled with --export-shm.
+    FrameExport frameExport;
+
+    // Accepts commands from scripts at each frame boundary, if enabled with --control-socket.
+    ControlServer controlServer;
+
+    // The path the recorded movie is written to on exit, if recording was enabled with --record.
+    const char *moviePath;
+
+    // The movie given with --replay, and its progress while C8VM.isReplayingMovie is set.
+    C8_Movie replayMovie;
+    C8_MoviePlayer moviePlayer;
+
+    // The number of upcoming frames that must be drawn regardless of whether anything else changed.
+    int pendingDraws;
+
+    // The layout and display generation shown by the last drawn frame.
+    Layout drawnLayout;
+    uint32_t drawnDisplayGeneration;
+} AppState;
 
 void OnClayError(const Clay_ErrorData errorData)
 {
@@ -70,16 +109,21 @@ void OnAudioDataRequested(void *userData, SDL_AudioStream *stream, const int add
     constexpr int sampleCount = 1024;
     float samples[sampleCount];
 
+    // The audio pattern buffer is played back one bit at a time, at a rate determined by the pitch register.
     constexpr int sampleRate = 44100;
+    constexpr float patternBits = XO_CHIP_AUDIO_PATTERN_SIZE * 8;
+    const float bitsPerSample = state->audioPlaybackRate / sampleRate;
+
     for (int i = 0; i < sampleCount; ++i)
     {
-        constexpr int frequency = 512;
-        const float phase = (float)(state->currentAudioSample * frequency) / sampleRate;
-        samples[i] = SDL_sinf(phase * 2 * SDL_PI_F);
-        ++state->currentAudioSample;
-    }
+        const int bit = (int)state->audioPatternPosition;
+        const bool isHigh = state->audioPattern[bit / 8] >> (7 - bit % 8) & 1;
+        samples[i] = isHigh ? 0.5f : -0.5f;
 
-    state->currentAudioSample %= sampleRate;
+        state->audioPatternPosition += bitsPerSample;
+        if (state->audioPatternPosition >= patternBits)
+            state->audioPatternPosition -= patternBits;
+    }
 
     SDL_PutAudioStreamData(stream, samples, sizeof(samples));
 }
@@ -142,7 +186,29 @@ void NotifyVirtualMachineKeyEvent(AppState *state, const SDL_Scancode scancode,
             return;
     }
 
-    C8_NotifyKeyEvent(&state->virtualMachine.instance, key, isPressed);
+    if (state->virtualMachine.isReplayingMovie)
+        return;
+
+    C8VM *virtualMachine = &state->virtualMachine;
+    if (virtualMachine->isRecordingMovie && !C8_RecordKeyEvent(&virtualMachine->movie, &virtualMachine->instance, key, isPressed))
+        virtualMachine->isRecordingMovie = false;
+    C8_NotifyKeyEvent(&virtualMachine->instance, key, isPressed);
+}
+
+// Requests that the next frames be drawn after an event that may change what is displayed.
+// Clay fires press callbacks while the layout is being built, so a second frame is drawn to show their effects.
+static void InvalidateFrame(AppState *state)
+{
+    state->pendingDraws = 2;
+}
+
+// Returns true if anything displayed has changed since the last drawn frame.
+static bool IsFrameInvalidated(const AppState *state)
+{
+    if (state->pendingDraws > 0 || state->layout != state->drawnLayout)
+        return true;
+
+    return state->layout == LAYOUT_MAIN && state->virtualMachine.instance.displayGeneration != state->drawnDisplayGeneration;
 }
 
 void OnKeyEvent(void *appstate, const SDL_Scancode scancode, const bool isPressed)
@@ -183,6 +249,112 @@ void OnKeyEvent(void *appstate, const SDL_Scancode scancode, const bool isPresse
     NotifyVirtualMachineKeyEvent(state, scancode, isPressed);
 }
 
+// Loads the program and the movie recorded from it, which then replaces the clock and keyboard until it ends.
+// Returns true if the replay started; otherwise, false, with the reason available from SDL_GetError.
+static bool BeginMovieReplay(AppState *state, const char *programPath, const char *moviePath)
+{
+    C8VM *virtualMachine = &state->virtualMachine;
+
+    char *error;
+    if (!C8_LoadMovie(&state->replayMovie, moviePath, &error))
+        return SDL_SetError("%s: %s", moviePath, error);
+
+    C8_Reset(&virtualMachine->instance);
+    virtualMachine->instance.config = state->replayMovie.config;
+    if (!C8_LoadProgram(&virtualMachine->instance, programPath, &error))
+        return SDL_SetError("%s: %s", programPath, error);
+
+    if (!C8_BeginReplay(&state->moviePlayer, &virtualMachine->instance, &state->replayMovie))
+        return SDL_SetError("%s was not recorded from %s", moviePath, programPath);
+
+    virtualMachine->programPath = SDL_strdup(programPath);
+    virtualMachine->isRunning = true;
+    virtualMachine->isReplayingMovie = true;
+    state->layout = LAYOUT_MAIN;
+    return true;
+}
+
+// Replays the next frame of the movie, logging the outcome once the replay ends.
+static void ReplayMovieFrame(AppState *state)
+{
+    const C8_ReplayStatus status = C8_ReplayFrame(&state->moviePlayer, &state->virtualMachine.instance);
+    if (status == C8_REPLAY_PLAYING)
+        return;
+
+    if (status == C8_REPLAY_FINISHED)
+        SDL_Log("Replay finished after %llu frames; every frame matched.", (unsigned long long)state->moviePlayer.frameCount);
+    else
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Replay diverged at frame %llu (cycle %llu).\n", (unsigned long long)state->moviePlayer.frameCount, (unsigned long long)state->virtualMachine.instance.cycleCount);
+
+    state->virtualMachine.isReplayingMovie = false;
+    state->virtualMachine.isRunning = false;
+}
+
+// Draws the Settings layout [frames] times with the geometry cache disabled and then enabled, logging the average time to draw each frame.
+// The cached UI layer is invalidated before every frame, so each one tessellates and submits the whole layout.
+static void RunSettingsBenchmark(AppState *state, const int frames)
+{
+    Uint64 frameTicks[2] = { 0 };
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        state->rendererData.isGeometryCacheDisabled = pass == 0;
+
+        for (int i = 0; i < frames; ++i)
+        {
+            Clay_RenderCommandArray renderCommands = SettingsLayout_CreateLayout(&state->layoutData);
+            SDL_Clay_InvalidateLayer(&state->rendererData);
+
+            const Uint64 ticksStart = SDL_GetTicksNS();
+            SDL_SetRenderDrawColor(state->rendererData.renderer, 0, 0, 0, 255);
+            SDL_RenderClear(state->rendererData.renderer);
+            SDL_Clay_RenderClayCommands(&state->rendererData, &renderCommands);
+            SDL_FlushRenderer(state->rendererData.renderer);
+            frameTicks[pass] += SDL_GetTicksNS() - ticksStart;
+
+            SDL_RenderPresent(state->rendererData.renderer);
+        }
+    }
+
+    // The Settings screen only draws a rounded rectangle while a tooltip is hovered, so the shapes the geometry cache
+    // serves are also timed on their own: a button-sized rounded rectangle and a quarter-circle border corner.
+    Uint64 shapeTicks[2][2] = { 0 };
+    const Clay_Color color = { 40, 40, 40, 255 };
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        state->rendererData.isGeometryCacheDisabled = pass == 0;
+
+        // Only the cost of producing the vertices is of interest, so they are discarded rather than drawn.
+        Uint64 ticksStart = SDL_GetTicksNS();
+        for (int i = 0; i < frames * BENCHMARK_SHAPES_PER_FRAME; ++i)
+        {
+            SDL_Clay_RenderFillRoundedRect(&state->rendererData, (SDL_FRect){ 0, 0, 320, 48 }, 8, color);
+            state->rendererData.batchVertexCount = state->rendererData.batchIndexCount = 0;
+        }
+        shapeTicks[pass][0] = SDL_GetTicksNS() - ticksStart;
+
+        ticksStart = SDL_GetTicksNS();
+        for (int i = 0; i < frames * BENCHMARK_SHAPES_PER_FRAME; ++i)
+        {
+            SDL_Clay_RenderArc(&state->rendererData, (SDL_FPoint){ 8, 8 }, 8, 180, 270, 2, color);
+            state->rendererData.batchVertexCount = state->rendererData.batchIndexCount = 0;
+        }
+        shapeTicks[pass][1] = SDL_GetTicksNS() - ticksStart;
+    }
+
+    state->rendererData.isGeometryCacheDisabled = false;
+
+    const double uncachedTime = (double)frameTicks[0] / frames / 1000.0;
+    const double cachedTime = (double)frameTicks[1] / frames / 1000.0;
+    SDL_Log("Settings benchmark (%d frames): %.1fus per frame without the geometry cache, %.1fus with it (%.1f%% faster)",
+        frames, uncachedTime, cachedTime, uncachedTime > 0.0 ? (uncachedTime - cachedTime) / uncachedTime * 100.0 : 0.0);
+
+    const int shapes = frames * BENCHMARK_SHAPES_PER_FRAME;
+    SDL_Log("Shape benchmark (%d of each): rounded rectangle %.0fns without the geometry cache, %.0fns with it; arc %.0fns without, %.0fns with",
+        shapes, (double)shapeTicks[0][0] / shapes, (double)shapeTicks[1][0] / shapes, (double)shapeTicks[0][1] / shapes, (double)shapeTicks[1][1] / shapes);
+}
+
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     AppState *state = SDL_calloc(1, sizeof(AppState));
     if (!state) {
@@ -195,12 +367,19 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
         return SDL_APP_FAILURE;
     }
 
+#ifdef C8VM_USE_GLYPH_ATLAS
+    // Text is drawn from the glyph atlas baked into the executable, so no fonts are loaded at runtime.
+    if (!SDL_Clay_CreateGlyphAtlasTexture(&state->rendererData)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "SDL_Clay_CreateGlyphAtlasTexture failed: %s\n", SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+#else
     if (!TTF_Init()) {
         SDL_LogError(SDL_LOG_CATEGORY_ERROR, "TTF_Init failed: %s\n", SDL_GetError());
         return SDL_APP_FAILURE;
     }
 
-    state->rendererData.fonts = SDL_calloc(3, sizeof(TTF_Font *));
+    state->rendererData.fonts = SDL_calloc(FONT_COUNT, sizeof(TTF_Font *));
     if (!state->rendererData.fonts) {
         SDL_LogError(SDL_LOG_CATEGORY_ERROR, "SDL_calloc failed: %s\n", SDL_GetError());
         return SDL_APP_FAILURE;
@@ -223,6 +402,7 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     state->rendererData.fonts[FONT_PIXELOID_SANS_16PT] = fontPixeloidSans16pt;
     state->rendererData.fonts[FONT_PIXELOID_SANS_BOLD_32PT] = fontPixeloidSansBold32pt;
     state->rendererData.fonts[FONT_PIXELOID_SANS_BOLD_48PT] = fontPixeloidSansBold48pt;
+#endif
 
     const uint32_t memorySize = Clay_MinMemorySize();
     const Clay_Arena arena = Clay_CreateArenaWithCapacityAndMemory(memorySize, SDL_malloc(memorySize));
@@ -231,7 +411,7 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     SDL_GetWindowSize(state->window, &width, &height);
 
     Clay_Initialize(arena, (Clay_Dimensions){ (float)width, (float)height }, (Clay_ErrorHandler){ .errorHandlerFunction = OnClayError });
-    Clay_SetMeasureTextFunction(SDL_MeasureText, state->rendererData.fonts);
+    Clay_SetMeasureTextFunction(SDL_Clay_MeasureText, &state->rendererData);
 
     if (!SDL_InitSubSystem(SDL_INIT_AUDIO))
     {
@@ -248,25 +428,129 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
 
     state->frameArena = CreateArena(1024);
 
+    state->jobPool = CreateJobPool(0);
+    if (!state->jobPool)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "CreateJobPool failed: %s\n", SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+
     state->layoutData = (LayoutData){
         .frameArena = &state->frameArena,
+        .jobPool = state->jobPool,
         .layout = &state->layout,
         .virtualMachine = &state->virtualMachine,
     };
 
     state->virtualMachine.cyclesPerSecond = DEFAULT_CLOCK_RATE;
-    state->virtualMachine.instance.config = (C8_Config){
+    state->virtualMachine.autoDetectQuirks = true;
+    state->virtualMachine.config = (C8_Config){
         .useParameterisedShift = true,
         .useParameterisedJump = true,
         .useTemporaryIndex = true
     };
 
+    InvalidateFrame(state);
+
     *appstate = state;
 
+    // Flags are matched anywhere on the command line; options are only matched when followed by their values.
+    int benchmarkFrames = 0;
+    const char *replayProgramPath = nullptr;
+    const char *replayMoviePath = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (SDL_strcmp(argv[i], "--export-shm") == 0 && i + 1 < argc)
+        {
+            if (!CreateFrameExport(&state->frameExport, argv[++i]))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_ERROR, "CreateFrameExport failed: %s\n", SDL_GetError());
+                return SDL_APP_FAILURE;
+            }
+        }
+        else if (SDL_strcmp(argv[i], "--control-socket") == 0 && i + 1 < argc)
+        {
+            if (!CreateControlServer(&state->controlServer, argv[++i]))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_ERROR, "CreateControlServer failed: %s\n", SDL_GetError());
+                return SDL_APP_FAILURE;
+            }
+        }
+        else if (SDL_strcmp(argv[i], "--guest-timers") == 0)
+        {
+            state->virtualMachine.config.cyclesPerTimerTick = state->virtualMachine.cyclesPerSecond / 60;
+        }
+        else if (SDL_strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            state->moviePath = argv[++i];
+            state->virtualMachine.isRecordingMovie = true;
+        }
+        else if (SDL_strcmp(argv[i], "--replay") == 0 && i + 2 < argc)
+        {
+            replayProgramPath = argv[++i];
+            replayMoviePath = argv[++i];
+        }
+        else if (SDL_strcmp(argv[i], "--benchmark-settings") == 0)
+        {
+            // The frame count is optional, so the next argument is only taken if it is a number.
+            benchmarkFrames = DEFAULT_BENCHMARK_FRAMES;
+            if (i + 1 < argc && SDL_isdigit((unsigned char)argv[i + 1][0]))
+            {
+                const int frames = SDL_atoi(argv[++i]);
+                benchmarkFrames = SDL_max(frames, 1);
+            }
+        }
+    }
+
+    // The replay is started once every option has been applied, and runs with the movie's configuration alone, so
+    // options such as --guest-timers can't make it diverge wherever they appear.
+    if (replayMoviePath && !BeginMovieReplay(state, replayProgramPath, replayMoviePath))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "BeginMovieReplay failed: %s\n", SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+
+    if (benchmarkFrames)
+    {
+        RunSettingsBenchmark(state, benchmarkFrames);
+        return SDL_APP_SUCCESS;
+    }
+
     return SDL_APP_CONTINUE;
 }
 
 SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
+    switch (event->type) {
+        case SDL_EVENT_KEY_DOWN:
+        case SDL_EVENT_KEY_UP:
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+        case SDL_EVENT_MOUSE_MOTION:
+        case SDL_EVENT_WINDOW_RESIZED:
+        case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+        case SDL_EVENT_WINDOW_EXPOSED:
+        case SDL_EVENT_WINDOW_RESTORED:
+        case SDL_EVENT_WINDOW_MOUSE_LEAVE:
+            InvalidateFrame(appstate);
+            break;
+        case SDL_EVENT_RENDER_TARGETS_RESET:
+            // The contents of the cached UI layer were lost along with the renderer's render targets.
+            SDL_Clay_InvalidateLayer(&((AppState *)appstate)->rendererData);
+            InvalidateFrame(appstate);
+            break;
+        case SDL_EVENT_RENDER_DEVICE_RESET:
+            // Every texture was lost along with the device, including the display and the glyph atlas.
+            if (!SDL_Clay_RecreateTextures(&((AppState *)appstate)->rendererData))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_ERROR, "SDL_Clay_RecreateTextures failed: %s\n", SDL_GetError());
+                return SDL_APP_FAILURE;
+            }
+            InvalidateFrame(appstate);
+            break;
+        default:
+            break;
+    }
+
     switch (event->type) {
         case SDL_EVENT_KEY_DOWN:
         case SDL_EVENT_KEY_UP:
@@ -285,48 +569,136 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
         case SDL_EVENT_QUIT:
             return SDL_APP_SUCCESS;
         default:
+            if (SelectLayout_HandleEvent(event))
+                InvalidateFrame(appstate);
             break;
     }
 
     return SDL_APP_CONTINUE;
 }
 
-SDL_AppResult SDL_AppIterate(void *appstate)
+// Sleeps until [deadline], waking early if an event arrives so that it can be handled without delay.
+// Waiting for events only has millisecond resolution, so the final millisecond is slept precisely.
+// Returns true if the deadline was reached; otherwise, false.
+static bool WaitUntilDeadline(AppState *state, const Uint64 deadline)
 {
-    constexpr uint64_t ticksPerSecond = 1000000000;
-    constexpr uint64_t drawsPerSecond = 60;
-    constexpr uint64_t ticksPerDraw = ticksPerSecond / drawsPerSecond;
+    Uint64 ticksNow = SDL_GetTicksNS();
+    if (ticksNow >= deadline)
+        return true;
+
+    const Uint64 ticksRemaining = deadline - ticksNow;
+    if (ticksRemaining > 2 * TICKS_PER_MILLISECOND && SDL_WaitEventTimeout(nullptr, (Sint32)(ticksRemaining / TICKS_PER_MILLISECOND) - 1))
+        return false;
+
+    ticksNow = SDL_GetTicksNS();
+    if (ticksNow < deadline)
+        SDL_DelayPrecise(deadline - ticksNow);
+
+    const Uint64 jitter = SDL_GetTicksNS() - deadline;
+    ++state->metrics.wakeUpsPerSecond;
+    state->metrics.wakeUpJitterTotal += jitter;
+    state->metrics.wakeUpJitterMax = SDL_max(state->metrics.wakeUpJitterMax, jitter);
+    return true;
+}
 
+SDL_AppResult SDL_AppIterate(void *appstate)
+{
     AppState *state = appstate;
 
+    const Uint64 ticksPerCycle = TICKS_PER_SECOND / state->virtualMachine.cyclesPerSecond;
+    const Uint64 ticksPerCycleBatch = SDL_max(ticksPerCycle, MINIMUM_TICKS_PER_CYCLE_BATCH);
+
+    // Sleep until the next cycle batch or 60Hz tick is due, whichever is sooner.
+    // Audio is refilled by its own callback, so it doesn't need a deadline here.
+    Uint64 deadline = state->metrics.ticksLastFrame + TICKS_PER_FRAME;
+    if (state->virtualMachine.isRunning)
+        deadline = SDL_min(deadline, state->metrics.ticksLastCycle + ticksPerCycleBatch);
+
+    if (!WaitUntilDeadline(state, deadline))
+        return SDL_APP_CONTINUE;
+
     ++state->metrics.iterationsPerSecond;
 
-    const Uint64 ticksPerCycle = ticksPerSecond / state->virtualMachine.cyclesPerSecond;
     const Uint64 ticksNow = SDL_GetTicksNS();
 
-    if (ticksNow - state->metrics.ticksLastIteration > ticksPerSecond)
+    if (ticksNow - state->metrics.ticksLastIteration > TICKS_PER_SECOND)
     {
-        char title[256];
-        sprintf_s(title, 256, "%s [Iterations: %llu/s, Cycles: %llu/s, Frames: %llu/s]", WINDOW_TITLE, state->metrics.iterationsPerSecond, state->metrics.cyclesPerSecond, state->metrics.framesPerSecond);
+        const double averageJitter = state->metrics.wakeUpsPerSecond ? (double)state->metrics.wakeUpJitterTotal / state->metrics.wakeUpsPerSecond / 1000.0 : 0.0;
+        const double maximumJitter = (double)state->metrics.wakeUpJitterMax / 1000.0;
+        const double averageLayoutTime = state->metrics.drawsPerSecond ? (double)state->metrics.layoutTicksTotal / state->metrics.drawsPerSecond / 1000.0 : 0.0;
+
+        // Every number may be up to 20 digits long, so the title is formatted with room to spare and truncated if need be.
+        char title[512];
+        SDL_snprintf(title, sizeof(title), "%s [Iterations: %" SDL_PRIu64 "/s, Cycles: %" SDL_PRIu64 "/s, Frames: %" SDL_PRIu64 "/s, Draws: %" SDL_PRIu64 "/s, Text Misses: %" SDL_PRIu64 "/s, Batches: %" SDL_PRIu64 "/s, Layout: %.1fus, Jitter: %.1fus avg, %.1fus max, Frame Arena: %zu B peak, %" SDL_PRIu64 " overflows]", WINDOW_TITLE, state->metrics.iterationsPerSecond, state->metrics.cyclesPerSecond, state->metrics.framesPerSecond, state->metrics.drawsPerSecond, state->rendererData.textCacheMisses, state->rendererData.batchSubmissions, averageLayoutTime, averageJitter, maximumJitter, state->frameArena.highWaterMark, state->frameArena.overflowCount);
         SDL_SetWindowTitle(state->window, title);
-        state->metrics.iterationsPerSecond = state->metrics.cyclesPerSecond = state->metrics.framesPerSecond = 0;
+        state->metrics.iterationsPerSecond = state->metrics.cyclesPerSecond = state->metrics.framesPerSecond = state->metrics.drawsPerSecond = 0;
+        state->metrics.wakeUpsPerSecond = state->metrics.wakeUpJitterTotal = state->metrics.wakeUpJitterMax = state->metrics.layoutTicksTotal = 0;
+        state->rendererData.textCacheMisses = 0;
+        state->rendererData.batchSubmissions = 0;
         state->metrics.ticksLastIteration = ticksNow;
     }
 
-    if (ticksNow - state->metrics.ticksLastCycle >= ticksPerCycle && state->virtualMachine.isRunning)
+    // While replaying, cycles are executed a frame at a time by the movie rather than by the clock.
+    if (state->virtualMachine.isRunning && !state->virtualMachine.isReplayingMovie)
+    {
+        // Execute every cycle that has fallen due, but drop any backlog beyond a frame, e.g. after the window was dragged.
+        if (ticksNow - state->metrics.ticksLastCycle > TICKS_PER_FRAME)
+            state->metrics.ticksLastCycle = ticksNow - TICKS_PER_FRAME;
+
+        const Uint64 cyclesDue = (ticksNow - state->metrics.ticksLastCycle) / ticksPerCycle;
+        C8_RunCycles(&state->virtualMachine.instance, (uint32_t)cyclesDue);
+
+        state->metrics.cyclesPerSecond += cyclesDue;
+        state->metrics.ticksLastCycle += cyclesDue * ticksPerCycle;
+    }
+    else
     {
-        ++state->metrics.cyclesPerSecond;
         state->metrics.ticksLastCycle = ticksNow;
-        C8_FetchExecute(&state->virtualMachine.instance);
     }
 
-    if (ticksNow - state->metrics.ticksLastFrame > ticksPerDraw)
+    if (ticksNow - state->metrics.ticksLastFrame >= TICKS_PER_FRAME)
     {
         ++state->metrics.framesPerSecond;
-        state->metrics.ticksLastFrame = ticksNow;
 
-        if (state->virtualMachine.isRunning)
-            C8_UpdateTimers(&state->virtualMachine.instance);
+        // Ticks are scheduled from the previous deadline rather than the wake-up time, so they don't drift.
+        state->metrics.ticksLastFrame += TICKS_PER_FRAME;
+        if (ticksNow - state->metrics.ticksLastFrame >= TICKS_PER_FRAME)
+            state->metrics.ticksLastFrame = ticksNow;
+
+        C8VM *virtualMachine = &state->virtualMachine;
+        if (virtualMachine->isRunning && state->virtualMachine.isReplayingMovie)
+        {
+            ReplayMovieFrame(state);
+        }
+        else if (virtualMachine->isRunning)
+        {
+            // With guest timers, the timers were already updated as the cycles were executed.
+            if (!virtualMachine->instance.config.cyclesPerTimerTick)
+                C8_UpdateTimers(&virtualMachine->instance);
+
+            if (virtualMachine->isRecordingMovie && !C8_RecordFrame(&virtualMachine->movie, &virtualMachine->instance))
+                virtualMachine->isRecordingMovie = false;
+        }
+
+        // Scripted commands are applied between frames, so they never observe a frame half-executed.
+        const int controlEvents = PollControlServer(&state->controlServer, &state->virtualMachine);
+        if (controlEvents & CONTROL_EVENT_QUIT_REQUESTED)
+            return SDL_APP_SUCCESS;
+        if (controlEvents & CONTROL_EVENT_PROGRAM_LOADED)
+        {
+            state->layout = LAYOUT_MAIN;
+            InvalidateFrame(state);
+        }
+
+        PublishFrame(&state->frameExport, &state->virtualMachine.instance);
+
+        // The audio callback holds the stream's lock while it runs, so it never sees a partially copied pattern.
+        if (SDL_LockAudioStream(state->audioStream))
+        {
+            SDL_memcpy(state->audioPattern, state->virtualMachine.instance.audioPattern, sizeof(state->audioPattern));
+            state->audioPlaybackRate = C8_GetAudioPlaybackRate(&state->virtualMachine.instance);
+            SDL_UnlockAudioStream(state->audioStream);
+        }
 
         const bool isAudioDevicePaused = SDL_AudioStreamDevicePaused(state->audioStream);
         if (state->virtualMachine.instance.st > 0 && isAudioDevicePaused)
@@ -334,8 +706,18 @@ SDL_AppResult SDL_AppIterate(void *appstate)
         else if (state->virtualMachine.instance.st <= 0 && !isAudioDevicePaused)
             SDL_PauseAudioStreamDevice(state->audioStream);
 
+        // Audio and timers above are updated every frame, but layout and presentation are skipped while nothing displayed has changed.
+        if (!IsFrameInvalidated(state))
+            return SDL_APP_CONTINUE;
+
+        ++state->metrics.drawsPerSecond;
+        if (state->pendingDraws > 0)
+            --state->pendingDraws;
+
+        const Layout drawnLayout = state->layout;
+        const Uint64 ticksLayoutStart = SDL_GetTicksNS();
         Clay_RenderCommandArray renderCommands;
-        switch (state->layout)
+        switch (drawnLayout)
         {
             case LAYOUT_SELECT:
                 renderCommands = SelectLayout_CreateLayout(&state->layoutData);
@@ -354,12 +736,18 @@ SDL_AppResult SDL_AppIterate(void *appstate)
                 break;
         }
 
+        state->metrics.layoutTicksTotal += SDL_GetTicksNS() - ticksLayoutStart;
+
         SDL_SetRenderDrawColor(state->rendererData.renderer, 0, 0, 0, 255);
         SDL_RenderClear(state->rendererData.renderer);
 
         SDL_Clay_RenderClayCommands(&state->rendererData, &renderCommands);
 
         SDL_RenderPresent(state->rendererData.renderer);
+
+        // Callbacks fired while building the layout may have switched to another, which the next frame then draws.
+        state->drawnLayout = drawnLayout;
+        state->drawnDisplayGeneration = state->virtualMachine.instance.displayGeneration;
     }
 
     return SDL_APP_CONTINUE;
@@ -370,27 +758,60 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result) {
 
     if (state)
     {
-        if (state->rendererData.renderer)
-            SDL_DestroyRenderer(state->rendererData.renderer);
+        if (state->rendererData.displayTexture)
+            SDL_DestroyTexture(state->rendererData.displayTexture);
 
-        if (state->window)
-            SDL_DestroyWindow(state->window);
+        SDL_Clay_FreeLayer(&state->rendererData);
+        SDL_Clay_FreeBatch(&state->rendererData);
+        SDL_Clay_FreeGeometryCache(&state->rendererData);
+
+#ifdef C8VM_USE_GLYPH_ATLAS
+        if (state->rendererData.glyphAtlasTexture)
+            SDL_DestroyTexture(state->rendererData.glyphAtlasTexture);
+#else
+        SDL_Clay_EvictCachedText(&state->rendererData, true);
+
+        if (state->rendererData.textEngine)
+            TTF_DestroyRendererTextEngine(state->rendererData.textEngine);
+
+        SDL_Clay_CloseFontVariants(&state->rendererData);
 
         if (state->rendererData.fonts)
         {
-            for (size_t i = 0; i < sizeof(state->rendererData.fonts) / sizeof(*state->rendererData.fonts); ++i)
+            for (size_t i = 0; i < FONT_COUNT; ++i)
                 TTF_CloseFont(state->rendererData.fonts[i]);
 
             SDL_free(state->rendererData.fonts);
         }
+#endif
 
-        if (state->rendererData.textEngine)
-            TTF_DestroyRendererTextEngine(state->rendererData.textEngine);
+        if (state->rendererData.renderer)
+            SDL_DestroyRenderer(state->rendererData.renderer);
+
+        if (state->window)
+            SDL_DestroyWindow(state->window);
+
+        C8_Reset(&state->virtualMachine.instance);
+
+        char *error;
+        if (state->moviePath && state->virtualMachine.movie.eventCount > 0 && !C8_SaveMovie(&state->virtualMachine.movie, state->moviePath, &error))
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "C8_SaveMovie failed: %s\n", error);
+        if (state->moviePath && !state->virtualMachine.isRecordingMovie)
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Recording stopped early, as memory ran out.\n");
+        C8_FreeMovie(&state->virtualMachine.movie);
+        C8_FreeMovie(&state->replayMovie);
+
+        FreeFrameExport(&state->frameExport);
+        FreeControlServer(&state->controlServer);
 
         FreeArena(&state->frameArena);
 
+        FreeJobPool(state->jobPool);
+
         SDL_free(state);
     }
 
+#ifndef C8VM_USE_GLYPH_ATLAS
     TTF_Quit();
+#endif
 }
\ No newline at end of file
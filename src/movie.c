@@ -0,0 +1,313 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "movie.h"
+
+// Identifies movie files, followed by the version of their format.
+static const uint8_t MOVIE_MAGIC[4] = { 'C', '8', 'M', 'V' };
+#define MOVIE_VERSION 1
+
+// The size (in bytes) of the header preceding the events:
+// magic, uint8 version, uint8 platform, uint8 quirk flags, uint8 reserved, uint32 random seed, uint16 initial keys,
+// uint16 cycles per timer tick, uint64 initial state hash, uint64 event count.
+#define MOVIE_HEADER_SIZE 32
+
+// The largest size (in bytes) of an encoded event: a varint of up to 10 bytes, then a state hash.
+#define MOVIE_MAX_EVENT_SIZE 18
+
+// Bits of the quirk flags byte in the header.
+#define QUIRK_PARAMETERISED_SHIFT 0x1
+#define QUIRK_PARAMETERISED_JUMP 0x2
+#define QUIRK_TEMPORARY_INDEX 0x4
+
+static bool AppendEvent(C8_Movie *movie, const C8_MovieEvent event)
+{
+	if (movie->eventCount == movie->eventCapacity)
+	{
+		const size_t capacity = movie->eventCapacity ? movie->eventCapacity * 2 : 1024;
+		C8_MovieEvent *events = realloc(movie->events, capacity * sizeof(C8_MovieEvent));
+		if (!events)
+			return false;
+
+		movie->events = events;
+		movie->eventCapacity = capacity;
+	}
+
+	movie->events[movie->eventCount++] = event;
+	return true;
+}
+
+void C8_BeginMovie(C8_Movie *movie, const C8_Instance *instance)
+{
+	movie->config = instance->config;
+	movie->randomSeed = instance->randomState;
+	movie->initialHash = C8_GetStateHash(instance);
+	movie->initialKeys = 0;
+	for (uint8_t key = 0; key < 16; ++key)
+		movie->initialKeys |= (uint16_t)(instance->keysPressed[key] << key);
+	movie->eventCount = 0;
+}
+
+bool C8_RecordKeyEvent(C8_Movie *movie, const C8_Instance *instance, const uint8_t key, const bool isPressed)
+{
+	return AppendEvent(movie, (C8_MovieEvent){
+		.type = C8_MOVIE_EVENT_KEY,
+		.cycle = instance->cycleCount,
+		.key = key,
+		.isPressed = isPressed
+	});
+}
+
+bool C8_RecordFrame(C8_Movie *movie, const C8_Instance *instance)
+{
+	return AppendEvent(movie, (C8_MovieEvent){
+		.type = C8_MOVIE_EVENT_FRAME,
+		.cycle = instance->cycleCount,
+		.stateHash = C8_GetStateHash(instance)
+	});
+}
+
+static void WriteLittleEndian(uint8_t *bytes, const uint64_t value, const uint8_t size)
+{
+	for (uint8_t i = 0; i < size; ++i)
+		bytes[i] = (uint8_t)(value >> 8 * i);
+}
+
+static uint64_t ReadLittleEndian(const uint8_t *bytes, const uint8_t size)
+{
+	uint64_t value = 0;
+	for (uint8_t i = 0; i < size; ++i)
+		value |= (uint64_t)bytes[i] << 8 * i;
+	return value;
+}
+
+bool C8_SaveMovie(const C8_Movie *movie, const char *filePath, char **error)
+{
+	// Events are delta-coded: each starts with a varint of the cycles since the previous event, shifted left to make
+	// room for its type. A key event is followed by a byte holding the key, with bit 4 set if it was pressed;
+	// a frame event is followed by its state hash. Frames are usually tens of cycles apart, so most events take
+	// 2 or 9 bytes.
+	uint8_t *buffer = malloc(MOVIE_HEADER_SIZE + movie->eventCount * MOVIE_MAX_EVENT_SIZE);
+	if (!buffer)
+	{
+		*error = "Failed to allocate memory.";
+		return false;
+	}
+
+	memset(buffer, 0, MOVIE_HEADER_SIZE);
+	memcpy(buffer, MOVIE_MAGIC, sizeof(MOVIE_MAGIC));
+	buffer[4] = MOVIE_VERSION;
+	buffer[5] = (uint8_t)movie->config.platform;
+	buffer[6] = (movie->config.useParameterisedShift ? QUIRK_PARAMETERISED_SHIFT : 0)
+		| (movie->config.useParameterisedJump ? QUIRK_PARAMETERISED_JUMP : 0)
+		| (movie->config.useTemporaryIndex ? QUIRK_TEMPORARY_INDEX : 0);
+	WriteLittleEndian(buffer + 8, movie->randomSeed, 4);
+	WriteLittleEndian(buffer + 12, movie->initialKeys, 2);
+	WriteLittleEndian(buffer + 14, movie->config.cyclesPerTimerTick, 2);
+	WriteLittleEndian(buffer + 16, movie->initialHash, 8);
+	WriteLittleEndian(buffer + 24, movie->eventCount, 8);
+
+	size_t size = MOVIE_HEADER_SIZE;
+	uint64_t previousCycle = 0;
+	for (size_t i = 0; i < movie->eventCount; ++i)
+	{
+		const C8_MovieEvent *event = &movie->events[i];
+
+		uint64_t prefix = (event->cycle - previousCycle) << 1 | event->type;
+		previousCycle = event->cycle;
+		do
+		{
+			buffer[size++] = (uint8_t)(prefix & 0x7F) | (prefix > 0x7F ? 0x80 : 0);
+			prefix >>= 7;
+		} while (prefix);
+
+		if (event->type == C8_MOVIE_EVENT_KEY)
+		{
+			buffer[size++] = event->key | (event->isPressed ? 0x10 : 0);
+		}
+		else
+		{
+			WriteLittleEndian(buffer + size, event->stateHash, 8);
+			size += 8;
+		}
+	}
+
+	FILE *file = fopen(filePath, "wb");
+	if (!file)
+	{
+		*error = "Failed to open file at the specified path.";
+		free(buffer);
+		return false;
+	}
+
+	const bool isWritten = fwrite(buffer, 1, size, file) == size;
+	free(buffer);
+
+	if (fclose(file) != 0 || !isWritten)
+	{
+		*error = "Failed to write movie.";
+		return false;
+	}
+
+	return true;
+}
+
+bool C8_LoadMovie(C8_Movie *movie, const char *filePath, char **error)
+{
+	FILE *file = fopen(filePath, "rb");
+	if (!file)
+	{
+		*error = "Failed to open file at the specified path.";
+		return false;
+	}
+
+	uint8_t header[MOVIE_HEADER_SIZE];
+	if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, MOVIE_MAGIC, sizeof(MOVIE_MAGIC)) != 0)
+	{
+		*error = "Failed to load movie - not a movie file.";
+		fclose(file);
+		return false;
+	}
+
+	if (header[4] != MOVIE_VERSION || header[5] > C8_PLATFORM_XO_CHIP)
+	{
+		*error = "Failed to load movie - unsupported version.";
+		fclose(file);
+		return false;
+	}
+
+	movie->config = (C8_Config){
+		.platform = (C8_Platform)header[5],
+		.useParameterisedShift = header[6] & QUIRK_PARAMETERISED_SHIFT,
+		.useParameterisedJump = header[6] & QUIRK_PARAMETERISED_JUMP,
+		.useTemporaryIndex = header[6] & QUIRK_TEMPORARY_INDEX,
+		.cyclesPerTimerTick = (uint16_t)ReadLittleEndian(header + 14, 2)
+	};
+	movie->randomSeed = (uint32_t)ReadLittleEndian(header + 8, 4);
+	movie->initialKeys = (uint16_t)ReadLittleEndian(header + 12, 2);
+	movie->initialHash = ReadLittleEndian(header + 16, 8);
+	movie->eventCount = 0;
+
+	const uint64_t eventCount = ReadLittleEndian(header + 24, 8);
+	uint64_t cycle = 0;
+	int byte = 0;
+	for (uint64_t i = 0; i < eventCount && byte != EOF; ++i)
+	{
+		uint64_t prefix = 0;
+		for (uint8_t shift = 0; shift < 64 && (byte = fgetc(file)) != EOF; shift += 7)
+		{
+			prefix |= (uint64_t)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				break;
+		}
+
+		cycle += prefix >> 1;
+		C8_MovieEvent event = {
+			.type = prefix & 1 ? C8_MOVIE_EVENT_FRAME : C8_MOVIE_EVENT_KEY,
+			.cycle = cycle
+		};
+
+		if (event.type == C8_MOVIE_EVENT_KEY)
+		{
+			byte = fgetc(file);
+			event.key = (uint8_t)(byte & 0xF);
+			event.isPressed = byte & 0x10;
+		}
+		else
+		{
+			uint8_t hash[8];
+			if (fread(hash, 1, sizeof(hash), file) != sizeof(hash))
+				byte = EOF;
+			event.stateHash = ReadLittleEndian(hash, 8);
+		}
+
+		if (byte == EOF)
+			break;
+
+		if (!AppendEvent(movie, event))
+		{
+			*error = "Failed to allocate memory.";
+			fclose(file);
+			return false;
+		}
+	}
+
+	fclose(file);
+
+	if (byte == EOF)
+	{
+		*error = "Failed to load movie - file is truncated.";
+		return false;
+	}
+
+	return true;
+}
+
+bool C8_BeginReplay(C8_MoviePlayer *player, C8_Instance *instance, const C8_Movie *movie)
+{
+	*player = (C8_MoviePlayer){
+		.movie = movie,
+		.status = C8_REPLAY_PLAYING
+	};
+
+	C8_SeedRandom(instance, movie->randomSeed);
+	for (uint8_t key = 0; key < 16; ++key)
+		instance->keysPressed[key] = movie->initialKeys >> key & 1;
+
+	if (C8_GetStateHash(instance) != movie->initialHash)
+	{
+		player->status = C8_REPLAY_DIVERGED;
+		return false;
+	}
+
+	return true;
+}
+
+C8_ReplayStatus C8_ReplayFrame(C8_MoviePlayer *player, C8_Instance *instance)
+{
+	const C8_Movie *movie = player->movie;
+
+	while (player->status == C8_REPLAY_PLAYING)
+	{
+		if (player->nextEvent == movie->eventCount)
+		{
+			player->status = C8_REPLAY_FINISHED;
+			break;
+		}
+
+		const C8_MovieEvent *event = &movie->events[player->nextEvent++];
+
+		if (event->cycle > instance->cycleCount)
+			C8_RunCycles(instance, (uint32_t)(event->cycle - instance->cycleCount));
+
+		// The cycle count stops advancing once execution halts, so a halt the recording didn't see shows up here.
+		if (instance->cycleCount != event->cycle)
+		{
+			player->status = C8_REPLAY_DIVERGED;
+			break;
+		}
+
+		if (event->type == C8_MOVIE_EVENT_KEY)
+		{
+			C8_NotifyKeyEvent(instance, event->key, event->isPressed);
+			continue;
+		}
+
+		if (!movie->config.cyclesPerTimerTick)
+			C8_UpdateTimers(instance);
+		++player->frameCount;
+
+		if (C8_GetStateHash(instance) != event->stateHash)
+			player->status = C8_REPLAY_DIVERGED;
+		break;
+	}
+
+	return player->status;
+}
+
+void C8_FreeMovie(C8_Movie *movie)
+{
+	free(movie->events);
+	*movie = (C8_Movie){ 0 };
+}
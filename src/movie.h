@@ -0,0 +1,108 @@
+#ifndef C8_MOVIE_H
+#define C8_MOVIE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vm.h"
+
+// Describes what happened at a point in a recorded session.
+typedef enum
+{
+	// A key was pressed or released with C8_NotifyKeyEvent.
+	C8_MOVIE_EVENT_KEY,
+
+	// A frame ended, and the timers were updated with C8_UpdateTimers unless the configuration sets cyclesPerTimerTick.
+	C8_MOVIE_EVENT_FRAME
+} C8_MovieEventType;
+
+typedef struct
+{
+	C8_MovieEventType type;
+
+	// The instance's cycle count when the event arrived.
+	uint64_t cycle;
+
+	// For key events, the key and whether it was pressed or released.
+	uint8_t key;
+	bool isPressed;
+
+	// For frame events, the state hash once the timers were updated, which replays are checked against.
+	uint64_t stateHash;
+} C8_MovieEvent;
+
+// The input to a session, recorded from the moment its program was loaded, which replays it exactly.
+// The program itself is not stored; it is identified by the state hash it was recorded from.
+typedef struct
+{
+	C8_Config config;
+	uint32_t randomSeed;
+
+	// The state hash and held keys (with bit (n) set for key (n)) when recording began.
+	uint64_t initialHash;
+	uint16_t initialKeys;
+
+	C8_MovieEvent *events;
+	size_t eventCount;
+	size_t eventCapacity;
+} C8_Movie;
+
+typedef enum
+{
+	// More events are left to replay.
+	C8_REPLAY_PLAYING,
+
+	// Every event was replayed, and every frame matched its recorded state hash.
+	C8_REPLAY_FINISHED,
+
+	// A frame did not match its recorded state hash, or execution halted before an event was due.
+	C8_REPLAY_DIVERGED
+} C8_ReplayStatus;
+
+// Feeds a movie's events to an instance at the cycles they were recorded at.
+typedef struct
+{
+	const C8_Movie *movie;
+	size_t nextEvent;
+
+	// The number of frames replayed, including a diverged frame.
+	uint64_t frameCount;
+
+	C8_ReplayStatus status;
+} C8_MoviePlayer;
+
+// Starts recording a movie from the instance's current state, discarding any events recorded previously.
+// Call this immediately after the program is loaded, as replays start from a freshly loaded program.
+void C8_BeginMovie(C8_Movie *movie, const C8_Instance *instance);
+
+// Records a key event that is about to be passed to C8_NotifyKeyEvent.
+// Returns true if the event was recorded; otherwise, false, if memory ran out.
+bool C8_RecordKeyEvent(C8_Movie *movie, const C8_Instance *instance, uint8_t key, bool isPressed);
+
+// Records the end of a frame. Call this immediately after C8_UpdateTimers, or where it would have been called if the
+// configuration sets cyclesPerTimerTick.
+// Returns true if the frame was recorded; otherwise, false, if memory ran out.
+bool C8_RecordFrame(C8_Movie *movie, const C8_Instance *instance);
+
+// Writes the movie to a compact binary file.
+// If this function returns false, error will be populated with a string describing the reason.
+bool C8_SaveMovie(const C8_Movie *movie, const char *filePath, char **error);
+
+// Reads a movie written by C8_SaveMovie, replacing any events the movie held.
+// If this function returns false, error will be populated with a string describing the reason.
+bool C8_LoadMovie(C8_Movie *movie, const char *filePath, char **error);
+
+// Prepares to replay the movie on an instance whose program was just loaded with the movie's configuration.
+// Returns false if the instance's state doesn't match the state the movie was recorded from, e.g. because another
+// program was loaded; otherwise, true.
+bool C8_BeginReplay(C8_MoviePlayer *player, C8_Instance *instance, const C8_Movie *movie);
+
+// Executes cycles and replays events up to and including the end of the next recorded frame,
+// then checks the instance's state hash against the recorded one.
+// Returns the status of the replay, which is also stored in the player.
+C8_ReplayStatus C8_ReplayFrame(C8_MoviePlayer *player, C8_Instance *instance);
+
+// Frees the events held by the movie.
+void C8_FreeMovie(C8_Movie *movie);
+
+#endif // C8_MOVIE_H
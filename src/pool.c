@@ -0,0 +1,82 @@
+#include <stdlib.h>
+
+#include "pool.h"
+
+static size_t AlignSize(const size_t size)
+{
+    return (size + INSTANCE_POOL_ALIGNMENT - 1) / INSTANCE_POOL_ALIGNMENT * INSTANCE_POOL_ALIGNMENT;
+}
+
+InstancePool CreateInstancePool(const C8_Instance *prototype, const size_t capacity, const bool useHugePages)
+{
+    const size_t memorySize = C8_GetMemorySize(prototype);
+    const size_t slotSize = AlignSize(sizeof(C8_Instance)) + AlignSize(memorySize);
+
+    return (InstancePool){
+        .arena = CreatePageArena(slotSize * (capacity > 0 ? capacity : 1), useHugePages),
+        .slotSize = slotSize,
+        .memorySize = memorySize
+    };
+}
+
+C8_Instance *AcquireInstance(InstancePool *pool, const C8_Instance *source)
+{
+    if (C8_GetMemorySize(source) != pool->memorySize)
+        return nullptr;
+
+    unsigned char *slot = pool->freeList;
+    if (slot)
+    {
+        pool->freeList = *(void **)slot;
+    }
+    else
+    {
+        if (pool->slotCount == pool->slotCapacity)
+        {
+            const size_t capacity = pool->slotCapacity ? pool->slotCapacity * 2 : 64;
+            C8_Instance **slots = realloc(pool->slots, capacity * sizeof(C8_Instance *));
+            if (!slots)
+                return nullptr;
+            pool->slots = slots;
+            pool->slotCapacity = capacity;
+        }
+
+        slot = RequestAlignedAllocationFromArena(&pool->arena, pool->slotSize, INSTANCE_POOL_ALIGNMENT);
+        if (!slot)
+            return nullptr;
+        pool->slots[pool->slotCount++] = (C8_Instance *)slot;
+    }
+
+    C8_Instance *instance = (C8_Instance *)slot;
+    C8_CopyInstanceInto(instance, source, slot + AlignSize(sizeof(C8_Instance)));
+    ++pool->liveCount;
+    return instance;
+}
+
+void ReleaseInstance(InstancePool *pool, C8_Instance *instance)
+{
+    C8_Reset(instance);
+    *(void **)instance = pool->freeList;
+    pool->freeList = instance;
+    --pool->liveCount;
+}
+
+void ResetInstancePool(InstancePool *pool)
+{
+    // Released slots hold no heap pages after being reset, so resetting every slot again is harmless.
+    for (size_t i = 0; i < pool->slotCount; ++i)
+        C8_Reset(pool->slots[i]);
+
+    ResetArena(&pool->arena);
+    pool->freeList = nullptr;
+    pool->slotCount = 0;
+    pool->liveCount = 0;
+}
+
+void FreeInstancePool(InstancePool *pool)
+{
+    ResetInstancePool(pool);
+    free(pool->slots);
+    FreeArena(&pool->arena);
+    *pool = (InstancePool){ 0 };
+}
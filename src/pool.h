@@ -0,0 +1,54 @@
+#ifndef C8VM_POOL_H
+#define C8VM_POOL_H
+
+#include <stdint.h>
+
+#include "arena.h"
+#include "vm.h"
+
+// The alignment of each instance handed out by an [InstancePool], so that no two instances share a cache line.
+#define INSTANCE_POOL_ALIGNMENT 64
+
+// Hands out copies of virtual machines from large slabs of memory, each in a fixed-size slot holding the instance
+// followed by its display memory and heap page table. Heap pages are shared with the source instance, copy-on-write.
+// Released slots are reused before the slabs grow, and the whole pool can be emptied at once.
+typedef struct
+{
+    Arena arena;
+
+    // The size (in bytes) of each slot, and of the display memory and heap page table within it.
+    size_t slotSize;
+    size_t memorySize;
+
+    // Released slots, linked through their first bytes.
+    void *freeList;
+
+    // Every slot taken from the arena since the last reset, so that their heap page references can be dropped together.
+    C8_Instance **slots;
+    size_t slotCount;
+    size_t slotCapacity;
+
+    // The number of instances currently handed out.
+    size_t liveCount;
+} InstancePool;
+
+// Creates a new [InstancePool] for copies of virtual machines laid out like [prototype], i.e. loaded for the same platform,
+// with room for [capacity] instances before the pool has to grow. If [useHugePages] is true, the slabs are backed by
+// huge pages where the operating system supports them.
+InstancePool CreateInstancePool(const C8_Instance *prototype, size_t capacity, bool useHugePages);
+
+// Copies [source] into a slot from the [pool].
+// Returns the copy, or a null pointer if memory ran out or [source] isn't laid out like the pool's prototype.
+C8_Instance *AcquireInstance(InstancePool *pool, const C8_Instance *source);
+
+// Returns the slot holding [instance] to the [pool] for reuse. The instance must not be used afterwards.
+void ReleaseInstance(InstancePool *pool, C8_Instance *instance);
+
+// Releases every instance acquired from the [pool] at once, dropping their references to shared heap pages.
+void ResetInstancePool(InstancePool *pool);
+
+// Frees the memory held by the [pool], and zeroes all fields.
+// After this function is called, the [pool] can no longer be used.
+void FreeInstancePool(InstancePool *pool);
+
+#endif // C8VM_POOL_H
@@ -0,0 +1,42 @@
+#include "probe.h"
+
+int64_t C8_ReadProbe(const C8_Instance *instance, const C8_MemoryProbe probe)
+{
+	uint64_t value = 0;
+
+	switch (probe.format)
+	{
+		case C8_PROBE_UNSIGNED:
+			for (uint8_t i = 0; i < probe.length && i < sizeof(uint64_t); ++i)
+				value = value << 8 | C8_ReadHeap(instance, probe.address + i);
+			break;
+		case C8_PROBE_BCD:
+			for (uint8_t i = 0; i < probe.length; ++i)
+				value = value * 10 + C8_ReadHeap(instance, probe.address + i);
+			break;
+		case C8_PROBE_REGISTER:
+			value = instance->v[probe.address & 0xF];
+			break;
+	}
+
+	return (int64_t)value;
+}
+
+bool C8_TestProbeCondition(const C8_Instance *instance, const C8_ProbeCondition condition)
+{
+	const int64_t value = C8_ReadProbe(instance, condition.probe);
+
+	switch (condition.comparison)
+	{
+		case C8_COMPARE_EQUAL:
+			return value == condition.value;
+		case C8_COMPARE_NOT_EQUAL:
+			return value != condition.value;
+		case C8_COMPARE_LESS:
+			return value < condition.value;
+		case C8_COMPARE_GREATER:
+			return value > condition.value;
+	}
+
+	return false;
+}
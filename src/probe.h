@@ -0,0 +1,52 @@
+#ifndef C8_PROBE_H
+#define C8_PROBE_H
+
+#include <stdint.h>
+
+#include "vm.h"
+
+// Describes how the value read by a probe is encoded in guest memory.
+typedef enum
+{
+	// A big-endian unsigned integer of [length] bytes (up to 8), starting at [address].
+	C8_PROBE_UNSIGNED,
+
+	// A decimal number of [length] digits, one per byte and most significant first, as written by 0xFX33.
+	C8_PROBE_BCD,
+
+	// The V register whose index is [address]; [length] is ignored.
+	C8_PROBE_REGISTER
+} C8_ProbeFormat;
+
+// Locates a value in guest memory that a program uses for game state, such as a score or a lives counter.
+typedef struct
+{
+	C8_ProbeFormat format;
+	uint16_t address;
+	uint8_t length;
+} C8_MemoryProbe;
+
+// Describes how the value read by a probe is compared with a constant.
+typedef enum
+{
+	C8_COMPARE_EQUAL,
+	C8_COMPARE_NOT_EQUAL,
+	C8_COMPARE_LESS,
+	C8_COMPARE_GREATER
+} C8_Comparison;
+
+// A condition on a value in guest memory, such as the lives counter reaching zero.
+typedef struct
+{
+	C8_MemoryProbe probe;
+	C8_Comparison comparison;
+	int64_t value;
+} C8_ProbeCondition;
+
+// Returns the value at the location described by the probe.
+int64_t C8_ReadProbe(const C8_Instance *instance, C8_MemoryProbe probe);
+
+// Returns true if the value read by the condition's probe satisfies its comparison; otherwise, false.
+bool C8_TestProbeCondition(const C8_Instance *instance, C8_ProbeCondition condition);
+
+#endif // C8_PROBE_H
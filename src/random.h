@@ -0,0 +1,29 @@
+#ifndef C8_RANDOM_H
+#define C8_RANDOM_H
+
+#include <stdint.h>
+
+// Advances an xorshift32 generator and returns its new state.
+// The state must not be zero, as xorshift32 never leaves the zero state.
+static inline uint32_t C8_NextRandom(uint32_t *state)
+{
+	uint32_t random = *state;
+	random ^= random << 13;
+	random ^= random >> 17;
+	random ^= random << 5;
+	*state = random;
+	return random;
+}
+
+// Scrambles an index into a seed, so that the values derived for neighbouring indices are uncorrelated.
+// The result may be zero, so substitute another value before using it to seed C8_NextRandom.
+static inline uint32_t C8_MixSeed(const uint32_t seed, const uint64_t index)
+{
+	uint32_t value = seed + (uint32_t)index * 0x9E3779B9u;
+	value = (value ^ value >> 16) * 0x7FEB352Du;
+	value = (value ^ value >> 15) * 0x846CA68Bu;
+	value ^= value >> 16;
+	return value;
+}
+
+#endif // C8_RANDOM_H
@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "search.h"
+
+// A simulated successor of a kept state.
+typedef struct
+{
+	int64_t score;
+	uint64_t hash;
+
+	// The index of the successor's instance, which also identifies its parent and action.
+	uint32_t child;
+
+	// False if the successor faulted, exited or could not be forked.
+	bool isAlive;
+} Candidate;
+
+// Records how a kept state was reached, so that the best trace can be recovered once the search ends.
+typedef struct
+{
+	uint32_t parent;
+	uint8_t action;
+} TraceNode;
+
+typedef struct
+{
+	const C8_SearchOptions *options;
+	C8_Instance *beam;
+	C8_Instance *children;
+	Candidate *candidates;
+} SearchJob;
+
+// Forks a kept state once for each action and simulates a step of each.
+static void ExpandState(void *userData, const size_t parent)
+{
+	const SearchJob *job = userData;
+
+	for (uint8_t action = 0; action < C8_SEARCH_ACTION_COUNT; ++action)
+	{
+		const uint32_t child = (uint32_t)parent * C8_SEARCH_ACTION_COUNT + action;
+		C8_Instance *instance = &job->children[child];
+		Candidate *candidate = &job->candidates[child];
+
+		*candidate = (Candidate){ .child = child };
+		if (!C8_Fork(instance, &job->beam[parent]))
+			continue;
+
+		C8_ApplyAction(instance, action);
+
+		for (uint16_t frame = 0; frame < job->options->framesPerStep && instance->status == C8_STATUS_RUNNING; ++frame)
+		{
+			for (uint16_t cycle = 0; cycle < job->options->cyclesPerFrame; ++cycle)
+				C8_FetchExecute(instance);
+			C8_UpdateTimers(instance);
+		}
+
+		candidate->isAlive = instance->status == C8_STATUS_RUNNING;
+		candidate->score = C8_ReadProbe(instance, job->options->score);
+		candidate->hash = C8_GetStateHash(instance);
+	}
+}
+
+void C8_ApplyAction(C8_Instance *instance, const uint8_t action)
+{
+	for (uint8_t key = 0; key < 16; ++key)
+	{
+		const bool isPressed = key == action;
+		if (instance->keysPressed[key] != isPressed)
+			C8_NotifyKeyEvent(instance, key, isPressed);
+	}
+}
+
+// Orders live candidates first, then by descending score. Ties are broken by hash, so that the search is deterministic.
+static int CompareCandidates(const void *a, const void *b)
+{
+	const Candidate *left = a;
+	const Candidate *right = b;
+
+	if (left->isAlive != right->isAlive)
+		return left->isAlive ? -1 : 1;
+	if (left->score != right->score)
+		return left->score > right->score ? -1 : 1;
+	if (left->hash != right->hash)
+		return left->hash < right->hash ? -1 : 1;
+	return left->child < right->child ? -1 : 1;
+}
+
+// Inserts a hash into an open-addressed set whose capacity is a power of two, with zero marking empty slots.
+// Returns false if the hash was already present.
+static bool InsertHash(uint64_t *set, const uint32_t capacity, uint64_t hash)
+{
+	hash = hash ? hash : 1;
+
+	for (uint32_t slot = (uint32_t)hash & (capacity - 1);; slot = (slot + 1) & (capacity - 1))
+	{
+		if (set[slot] == hash)
+			return false;
+		if (set[slot] == 0)
+		{
+			set[slot] = hash;
+			return true;
+		}
+	}
+}
+
+static void ResetInstances(C8_Instance *instances, const size_t count)
+{
+	if (!instances)
+		return;
+
+	for (size_t i = 0; i < count; ++i)
+		C8_Reset(&instances[i]);
+}
+
+bool C8_SearchInputs(const C8_Instance *instance, const C8_SearchOptions options, JobPool *pool, uint8_t *trace, C8_SearchResult *result)
+{
+	*result = (C8_SearchResult){
+		.score = C8_ReadProbe(instance, options.score)
+	};
+	memset(trace, C8_SEARCH_NO_KEY, options.steps);
+
+	if (options.steps == 0 || options.beamWidth == 0)
+		return true;
+
+	const size_t childCount = (size_t)options.beamWidth * C8_SEARCH_ACTION_COUNT;
+
+	// The hash set is kept at most half full, so that probes stay short.
+	uint32_t hashCapacity = 1;
+	while (hashCapacity < options.beamWidth * 2)
+		hashCapacity <<= 1;
+
+	C8_Instance *beam = calloc(options.beamWidth, sizeof(C8_Instance));
+	C8_Instance *nextBeam = calloc(options.beamWidth, sizeof(C8_Instance));
+	C8_Instance *children = calloc(childCount, sizeof(C8_Instance));
+	Candidate *candidates = malloc(childCount * sizeof(Candidate));
+	TraceNode *nodes = malloc((size_t)options.steps * options.beamWidth * sizeof(TraceNode));
+	uint64_t *hashSet = malloc(hashCapacity * sizeof(uint64_t));
+
+	bool isSuccessful = beam && nextBeam && children && candidates && nodes && hashSet && C8_CopyInstance(&beam[0], instance);
+
+	uint32_t beamCount = 1;
+	uint32_t bestStep = 0;
+	uint32_t bestIndex = 0;
+
+	for (uint32_t step = 0; step < options.steps && isSuccessful && beamCount > 0; ++step)
+	{
+		SearchJob job = {
+			.options = &options,
+			.beam = beam,
+			.children = children,
+			.candidates = candidates
+		};
+		RunJobsOnPool(pool, beamCount, ExpandState, &job);
+
+		const size_t candidateCount = (size_t)beamCount * C8_SEARCH_ACTION_COUNT;
+		result->statesExpanded += candidateCount;
+		qsort(candidates, candidateCount, sizeof(Candidate), CompareCandidates);
+
+		// Keep the best distinct live successors, which become the states expanded in the next step.
+		memset(hashSet, 0, hashCapacity * sizeof(uint64_t));
+		uint32_t keptCount = 0;
+		for (size_t i = 0; i < candidateCount && keptCount < options.beamWidth && candidates[i].isAlive; ++i)
+		{
+			if (!InsertHash(hashSet, hashCapacity, candidates[i].hash))
+			{
+				++result->duplicateStates;
+				continue;
+			}
+
+			if (!C8_Fork(&nextBeam[keptCount], &children[candidates[i].child]))
+			{
+				isSuccessful = false;
+				break;
+			}
+
+			nodes[(size_t)step * options.beamWidth + keptCount] = (TraceNode){
+				.parent = candidates[i].child / C8_SEARCH_ACTION_COUNT,
+				.action = candidates[i].child % C8_SEARCH_ACTION_COUNT
+			};
+			++keptCount;
+		}
+
+		// Candidates are sorted, so the first kept state holds the best score of this step.
+		if (keptCount > 0 && candidates[0].score > result->score)
+		{
+			result->score = candidates[0].score;
+			result->stepCount = step + 1;
+			bestStep = step;
+			bestIndex = 0;
+		}
+
+		C8_Instance *previousBeam = beam;
+		beam = nextBeam;
+		nextBeam = previousBeam;
+		beamCount = keptCount;
+	}
+
+	// Walk back from the best state to recover the actions that reached it.
+	if (isSuccessful && result->stepCount > 0)
+	{
+		uint32_t index = bestIndex;
+		for (uint32_t step = bestStep + 1; step-- > 0;)
+		{
+			const TraceNode node = nodes[(size_t)step * options.beamWidth + index];
+			trace[step] = node.action;
+			index = node.parent;
+		}
+	}
+
+	ResetInstances(beam, options.beamWidth);
+	ResetInstances(nextBeam, options.beamWidth);
+	ResetInstances(children, childCount);
+
+	free(hashSet);
+	free(nodes);
+	free(candidates);
+	free(children);
+	free(nextBeam);
+	free(beam);
+
+	return isSuccessful;
+}
@@ -0,0 +1,61 @@
+#ifndef C8_SEARCH_H
+#define C8_SEARCH_H
+
+#include <stdint.h>
+
+#include "jobs.h"
+#include "probe.h"
+#include "vm.h"
+
+// The action that holds no key; actions 0x0-0xF hold the corresponding key on the keypad.
+#define C8_SEARCH_NO_KEY 16
+
+// The number of actions available at each step of a search: one for each key, and one for holding no key.
+#define C8_SEARCH_ACTION_COUNT 17
+
+// Controls the budget and objective of an input search.
+typedef struct
+{
+	// The value to maximise, read from guest memory after each step.
+	C8_MemoryProbe score;
+
+	// The number of instructions executed per frame.
+	uint16_t cyclesPerFrame;
+
+	// The number of frames each action is held for before the next is chosen.
+	uint16_t framesPerStep;
+
+	// The maximum number of actions in the input trace.
+	uint32_t steps;
+
+	// The number of states kept after each step; each is expanded into C8_SEARCH_ACTION_COUNT successors.
+	uint32_t beamWidth;
+} C8_SearchOptions;
+
+// Summarises an input search.
+typedef struct
+{
+	// The highest score reached, and the number of steps taken to first reach it.
+	int64_t score;
+	uint32_t stepCount;
+
+	// The number of successor states simulated.
+	uint64_t statesExpanded;
+
+	// The number of successors discarded because an identical state was already kept in the same step.
+	uint64_t duplicateStates;
+} C8_SearchResult;
+
+// Presses the key selected by [action] and releases every other key. Keys already in the right state are left untouched,
+// so that holding the same action across steps does not press its key again.
+void C8_ApplyAction(C8_Instance *instance, uint8_t action);
+
+// Searches for the sequence of keypad inputs that maximises the score when played from the state of the provided virtual
+// machine, using a beam search over forked instances. Successors of each kept state are simulated in parallel on the
+// [pool], and successors with the same C8_GetStateHash are only kept once. Successors that fault or exit are discarded.
+// [trace] must have room for [options.steps] actions; the best trace is written to its first [result->stepCount] entries,
+// and the remainder is filled with C8_SEARCH_NO_KEY. The provided virtual machine is not modified.
+// Returns true if the search was successful; otherwise, false if memory could not be allocated.
+bool C8_SearchInputs(const C8_Instance *instance, C8_SearchOptions options, JobPool *pool, uint8_t *trace, C8_SearchResult *result);
+
+#endif // C8_SEARCH_H
@@ -1,9 +1,27 @@
+#include <math.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "random.h"
 #include "vm.h"
 
+// Wraps an address to the bounds of heap memory.
+#define HEAP_ADDRESS(address) ((address) & (instance->heapSize - 1))
+
+// The size (in bytes) of the reference count preceding each heap page, padded to keep the page aligned.
+#define HEAP_PAGE_HEADER_SIZE 16
+
+// Returns true if the instance implements the specified platform or a superset of it.
+#define IS_PLATFORM(platformToTest) (instance->config.platform >= (platformToTest))
+
+// The default audio pattern: a square wave with a period of 8 bits (500Hz at the default pitch).
+static const uint8_t DEFAULT_AUDIO_PATTERN[XO_CHIP_AUDIO_PATTERN_SIZE] = {
+	0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+	0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0
+};
+
 // Default font used by the virtual machine.
 static const uint8_t DEFAULT_FONT[] = {
 	0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
@@ -24,19 +42,348 @@ static const uint8_t DEFAULT_FONT[] = {
 	0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
-// Clears the display.
+// Large font used by SUPER-CHIP programs.
+static const uint8_t LARGE_FONT[] = {
+	0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+	0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+	0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+	0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+	0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+	0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+	0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+	0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+	0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+	0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+	0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+	0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+// Distinguishes heap bytes from framebuffer words with the same location and value.
+#define HEAP_HASH_SALT    0x5A0B8E2C71D3F649ull
+#define DISPLAY_HASH_SALT 0xC3A5C85C97CB3127ull
+
+// The splitmix64 finaliser: a bijective mix spreading every input bit across the result.
+static uint64_t MixHash(uint64_t value)
+{
+	value = (value ^ value >> 30) * 0xBF58476D1CE4E5B9ull;
+	value = (value ^ value >> 27) * 0x94D049BB133111EBull;
+	return value ^ value >> 31;
+}
+
+// Returns the contribution of a heap byte to the heap hash. Zero bytes contribute nothing, so a cleared heap hashes to zero.
+static uint64_t HashHeapByte(const uint32_t address, const uint8_t value)
+{
+	return value ? MixHash(((uint64_t)address << 8 | value) ^ HEAP_HASH_SALT) : 0;
+}
+
+// Returns the contribution of a framebuffer word to the display hash. Zero words contribute nothing.
+static uint64_t HashDisplayWord(const size_t index, const uint64_t word)
+{
+	return word ? MixHash(word ^ MixHash(index ^ DISPLAY_HASH_SALT)) : 0;
+}
+
+// Returns the combined contribution of the words in a row of the framebuffer.
+static uint64_t HashDisplayRow(const C8_Instance *instance, const uint64_t *row)
+{
+	const size_t index = row - instance->framebuffer;
+
+	uint64_t hash = 0;
+	for (uint8_t word = 0; word < instance->displayRowWords; ++word)
+		hash ^= HashDisplayWord(index + word, row[word]);
+	return hash;
+}
+
+// Recomputes the display hash from the whole framebuffer, after operations that move most of it.
+static void RehashDisplay(C8_Instance *instance)
+{
+	const size_t wordCount = C8_GetFramebufferSize(instance) / sizeof(uint64_t);
+
+	instance->displayHash = 0;
+	for (size_t word = 0; word < wordCount; ++word)
+		instance->displayHash ^= HashDisplayWord(word, instance->framebuffer[word]);
+}
+
+// Rotates the bits of a word to the right, wrapping those shifted out of the least significant bit.
+static uint64_t RotateRight(const uint64_t value, const uint8_t shift)
+{
+	return shift ? value >> shift | value << (C8_PIXELS_PER_WORD - shift) : value;
+}
+
+// XORs a sprite row into a row of the framebuffer at the specified horizontal position,
+// wrapping pixels that extend beyond the right edge of the display.
+// Returns true if any lit pixel was unlit; otherwise, false.
+static bool DrawSpriteRow(uint64_t *row, const uint16_t bits, const uint8_t spriteWidth, uint8_t x, const uint8_t displayWidth)
+{
+	const uint64_t sprite = (uint64_t)bits << (C8_PIXELS_PER_WORD - spriteWidth);
+
+	if (displayWidth == C8_PIXELS_PER_WORD)
+	{
+		const uint64_t mask = RotateRight(sprite, x);
+		const bool collided = row[0] & mask;
+		row[0] ^= mask;
+		return collided;
+	}
+
+	// Rotate the sprite across both words of a 128-pixel row.
+	uint64_t left = sprite, right = 0;
+	if (x >= C8_PIXELS_PER_WORD)
+	{
+		right = left;
+		left = 0;
+		x -= C8_PIXELS_PER_WORD;
+	}
+	if (x > 0)
+	{
+		const uint64_t carry = left << (C8_PIXELS_PER_WORD - x);
+		left = left >> x | right << (C8_PIXELS_PER_WORD - x);
+		right = right >> x | carry;
+	}
+
+	const bool collided = (row[0] & left) | (row[1] & right);
+	row[0] ^= left;
+	row[1] ^= right;
+	return collided;
+}
+
+// Every display row fits in the dirty row bitmask.
+static_assert(SUPER_CHIP_DISPLAY_HEIGHT <= 64);
+
+// Advances the display generation and records it as the generation in which the display rows in [rows] last changed.
+static void MarkRowsDirty(C8_Instance *instance, const uint64_t rows)
+{
+	++instance->displayGeneration;
+	for (uint8_t y = 0; y < SUPER_CHIP_DISPLAY_HEIGHT; ++y)
+	{
+		if (rows >> y & 1)
+			instance->rowGenerations[y] = instance->displayGeneration;
+	}
+}
+
+// Returns a bitmask covering every row of the display in its current mode.
+static uint64_t AllRows(const C8_Instance *instance)
+{
+	const uint8_t height = C8_GetDisplayHeight(instance);
+	return height == 64 ? UINT64_MAX : (1ull << height) - 1;
+}
+
+// Returns true if the specified bitplane is affected by drawing, clearing and scrolling.
+static bool IsPlaneSelected(const C8_Instance *instance, const uint8_t plane)
+{
+	return instance->selectedPlanes & 1 << plane;
+}
+
+// Scrolls the selected bitplanes down by (n) pixels.
+static void C8_00CN(C8_Instance *instance)
+{
+	const uint8_t height = C8_GetDisplayHeight(instance);
+	const uint8_t n = instance->instruction.n < height ? instance->instruction.n : height;
+	const size_t rowSize = instance->displayRowWords * sizeof(uint64_t);
+
+	for (uint8_t plane = 0; plane < instance->planeCount; ++plane)
+	{
+		if (!IsPlaneSelected(instance, plane))
+			continue;
+
+		uint64_t *top = C8_GetDisplayRow(instance, plane, 0);
+		memmove(C8_GetDisplayRow(instance, plane, n), top, (height - n) * rowSize);
+		memset(top, 0, n * rowSize);
+	}
+
+	RehashDisplay(instance);
+	MarkRowsDirty(instance, AllRows(instance));
+}
+
+// Scrolls the selected bitplanes up by (n) pixels.
+static void C8_00DN(C8_Instance *instance)
+{
+	const uint8_t height = C8_GetDisplayHeight(instance);
+	const uint8_t n = instance->instruction.n < height ? instance->instruction.n : height;
+	const size_t rowSize = instance->displayRowWords * sizeof(uint64_t);
+
+	for (uint8_t plane = 0; plane < instance->planeCount; ++plane)
+	{
+		if (!IsPlaneSelected(instance, plane))
+			continue;
+
+		uint64_t *top = C8_GetDisplayRow(instance, plane, 0);
+		memmove(top, C8_GetDisplayRow(instance, plane, n), (height - n) * rowSize);
+		memset(C8_GetDisplayRow(instance, plane, height - n), 0, n * rowSize);
+	}
+
+	RehashDisplay(instance);
+	MarkRowsDirty(instance, AllRows(instance));
+}
+
+// Clears the selected bitplanes.
 static void C8_00E0(C8_Instance *instance)
 {
-	memset(instance->framebuffer, 0, sizeof(instance->framebuffer));
+	const size_t planeSize = C8_GetFramebufferSize(instance) / instance->planeCount;
+
+	for (uint8_t plane = 0; plane < instance->planeCount; ++plane)
+	{
+		if (IsPlaneSelected(instance, plane))
+			memset(C8_GetDisplayRow(instance, plane, 0), 0, planeSize);
+	}
+
+	RehashDisplay(instance);
+	MarkRowsDirty(instance, AllRows(instance));
 }
 
 // Returns from the current subroutine.
 static void C8_00EE(C8_Instance *instance)
 {
+	if (instance->sp == 0)
+	{
+		instance->status = C8_STATUS_STACK_UNDERFLOW;
+		return;
+	}
+
 	instance->pc = instance->stack[--instance->sp];
 	instance->stack[instance->sp] = 0;
 }
 
+// Scrolls the selected bitplanes right by 4 pixels.
+static void C8_00FB(C8_Instance *instance)
+{
+	const uint8_t height = C8_GetDisplayHeight(instance);
+
+	for (uint8_t plane = 0; plane < instance->planeCount; ++plane)
+	{
+		if (!IsPlaneSelected(instance, plane))
+			continue;
+
+		for (uint8_t y = 0; y < height; ++y)
+		{
+			uint64_t *row = C8_GetDisplayRow(instance, plane, y);
+			if (instance->isHighResolution)
+				row[1] = row[1] >> 4 | row[0] << (C8_PIXELS_PER_WORD - 4);
+			row[0] >>= 4;
+		}
+	}
+
+	RehashDisplay(instance);
+	MarkRowsDirty(instance, AllRows(instance));
+}
+
+// Scrolls the selected bitplanes left by 4 pixels.
+static void C8_00FC(C8_Instance *instance)
+{
+	const uint8_t height = C8_GetDisplayHeight(instance);
+
+	for (uint8_t plane = 0; plane < instance->planeCount; ++plane)
+	{
+		if (!IsPlaneSelected(instance, plane))
+			continue;
+
+		for (uint8_t y = 0; y < height; ++y)
+		{
+			uint64_t *row = C8_GetDisplayRow(instance, plane, y);
+			row[0] <<= 4;
+			if (instance->isHighResolution)
+			{
+				row[0] |= row[1] >> (C8_PIXELS_PER_WORD - 4);
+				row[1] <<= 4;
+			}
+		}
+	}
+
+	RehashDisplay(instance);
+	MarkRowsDirty(instance, AllRows(instance));
+}
+
+// Exits the interpreter.
+static void C8_00FD(C8_Instance *instance)
+{
+	instance->status = C8_STATUS_EXITED;
+}
+
+// Switches the display to low-resolution (64x32) mode and clears all bitplanes.
+static void C8_00FE(C8_Instance *instance)
+{
+	instance->isHighResolution = false;
+	memset(instance->framebuffer, 0, C8_GetFramebufferSize(instance));
+	instance->displayHash = 0;
+	MarkRowsDirty(instance, AllRows(instance));
+}
+
+// Switches the display to high-resolution (128x64) mode and clears all bitplanes.
+static void C8_00FF(C8_Instance *instance)
+{
+	instance->isHighResolution = true;
+	memset(instance->framebuffer, 0, C8_GetFramebufferSize(instance));
+	instance->displayHash = 0;
+	MarkRowsDirty(instance, AllRows(instance));
+}
+
+// Returns the reference count of the instances sharing a heap page.
+static atomic_uint *GetPageReferenceCount(uint8_t *page)
+{
+	return (atomic_uint *)(page - HEAP_PAGE_HEADER_SIZE);
+}
+
+// Allocates a heap page with a single reference. Returns a null pointer if memory ran out.
+static uint8_t *AllocatePage(void)
+{
+	uint8_t *block = malloc(HEAP_PAGE_HEADER_SIZE + C8_HEAP_PAGE_SIZE);
+	if (!block)
+		return nullptr;
+
+	uint8_t *page = block + HEAP_PAGE_HEADER_SIZE;
+	atomic_init(GetPageReferenceCount(page), 1);
+	return page;
+}
+
+static void RetainPage(uint8_t *page)
+{
+	atomic_fetch_add_explicit(GetPageReferenceCount(page), 1, memory_order_relaxed);
+}
+
+// Drops a reference to a heap page, freeing it once no instance refers to it.
+static void ReleasePage(uint8_t *page)
+{
+	if (atomic_fetch_sub_explicit(GetPageReferenceCount(page), 1, memory_order_acq_rel) == 1)
+		free(page - HEAP_PAGE_HEADER_SIZE);
+}
+
+// Writes a byte to heap memory, first taking a private copy of its page if the page is shared with another instance.
+static void WriteHeap(C8_Instance *instance, const uint32_t address, const uint8_t value)
+{
+	const uint32_t wrapped = HEAP_ADDRESS(address);
+	uint8_t **page = &instance->heapPages[wrapped >> C8_HEAP_PAGE_SHIFT];
+
+	if (atomic_load_explicit(GetPageReferenceCount(*page), memory_order_acquire) > 1)
+	{
+		uint8_t *copy = AllocatePage();
+		if (!copy)
+		{
+			instance->status = C8_STATUS_OUT_OF_MEMORY;
+			return;
+		}
+
+		memcpy(copy, *page, C8_HEAP_PAGE_SIZE);
+		ReleasePage(*page);
+		*page = copy;
+	}
+
+	uint8_t *byte = &(*page)[wrapped & (C8_HEAP_PAGE_SIZE - 1)];
+	instance->heapHash ^= HashHeapByte(wrapped, *byte) ^ HashHeapByte(wrapped, value);
+	*byte = value;
+}
+
+// Skips the next instruction.
+// On XO-CHIP, the 4-byte 0xF000 NNNN instruction is skipped in its entirety.
+static void SkipNextInstruction(C8_Instance *instance)
+{
+	if (IS_PLATFORM(C8_PLATFORM_XO_CHIP) && C8_ReadHeap(instance, instance->pc) == 0xF0 && C8_ReadHeap(instance, instance->pc + 1) == 0x00)
+		instance->pc += INSTRUCTION_WIDTH;
+
+	instance->pc += INSTRUCTION_WIDTH;
+}
+
 // Jumps to the specified address.
 static void C8_1NNN(C8_Instance *instance)
 {
@@ -46,6 +393,12 @@ static void C8_1NNN(C8_Instance *instance)
 // Calls the subroutine at (nnn).
 static void C8_2NNN(C8_Instance *instance)
 {
+	if (instance->sp >= CHIP_8_STACK_DEPTH)
+	{
+		instance->status = C8_STATUS_STACK_OVERFLOW;
+		return;
+	}
+
 	instance->stack[instance->sp++] = instance->pc;
 	instance->pc = instance->instruction.nnn;
 }
@@ -54,21 +407,53 @@ static void C8_2NNN(C8_Instance *instance)
 static void C8_3XNN(C8_Instance *instance)
 {
 	if (instance->v[instance->instruction.x] == instance->instruction.nn)
-		instance->pc += INSTRUCTION_WIDTH;
+		SkipNextInstruction(instance);
 }
 
 // Skips the next instruction if the value in the V(x) register is not equal to (nn).
 static void C8_4XNN(C8_Instance *instance)
 {
 	if (instance->v[instance->instruction.x] != instance->instruction.nn)
-		instance->pc += INSTRUCTION_WIDTH;
+		SkipNextInstruction(instance);
 }
 
 // Skips the next instruction if the value in the V(x) register is equal to the value in the V(y) register.
 static void C8_5XY0(C8_Instance *instance)
 {
 	if (instance->v[instance->instruction.x] == instance->v[instance->instruction.y])
-		instance->pc += INSTRUCTION_WIDTH;
+		SkipNextInstruction(instance);
+}
+
+// Stores the values in registers V(x) to V(y) in successive memory addresses, starting at the address in the index register.
+// If (x) is greater than (y), the registers are stored in reverse order. The index register is left unchanged.
+static void C8_5XY2(C8_Instance *instance)
+{
+	const uint8_t x = instance->instruction.x;
+	const uint8_t y = instance->instruction.y;
+	const int8_t direction = x <= y ? 1 : -1;
+
+	for (uint8_t offset = 0, reg = x; ; ++offset, reg += direction)
+	{
+		WriteHeap(instance, instance->i + offset, instance->v[reg]);
+		if (reg == y)
+			break;
+	}
+}
+
+// Loads the values in successive memory addresses, starting at the address in the index register, into registers V(x) to V(y).
+// If (x) is greater than (y), the registers are loaded in reverse order. The index register is left unchanged.
+static void C8_5XY3(C8_Instance *instance)
+{
+	const uint8_t x = instance->instruction.x;
+	const uint8_t y = instance->instruction.y;
+	const int8_t direction = x <= y ? 1 : -1;
+
+	for (uint8_t offset = 0, reg = x; ; ++offset, reg += direction)
+	{
+		instance->v[reg] = C8_ReadHeap(instance, instance->i + offset);
+		if (reg == y)
+			break;
+	}
 }
 
 // Loads the immediate value (nn) into the V(x) register.
@@ -161,7 +546,7 @@ static void C8_9XY0(C8_Instance *instance)
 {
 	if (instance->v[instance->instruction.x] != instance->v[instance->instruction.y])
 	{
-		instance->pc += INSTRUCTION_WIDTH;
+		SkipNextInstruction(instance);
 	}
 }
 
@@ -181,53 +566,80 @@ static void C8_BNNN(C8_Instance *instance)
 // Generates a random number the range 0..255, ANDs it with (nn) and stores the result in the V(x) register.
 static void C8_CXNN(C8_Instance *instance)
 {
-	instance->v[instance->instruction.x] = rand() % (CHIP_8_RAND_MAX + 1) & instance->instruction.nn;
+	const uint32_t random = C8_NextRandom(&instance->randomState);
+	instance->v[instance->instruction.x] = random % (CHIP_8_RAND_MAX + 1) & instance->instruction.nn;
 }
 
 // Draws an (n)-pixels tall sprite at the co-ordinates in the V(x) and V(y) registers.
+// On SUPER-CHIP, if (n) is zero, draws a 16x16 sprite instead.
+// On XO-CHIP, the sprite is drawn to each selected bitplane in turn, using consecutive sprite data for each.
 static void C8_DXYN(C8_Instance *instance)
 {
-	const uint8_t x = instance->v[instance->instruction.x];
-	const uint8_t y = instance->v[instance->instruction.y];
-	const uint16_t sprite = instance->i;
+	const uint8_t width = C8_GetDisplayWidth(instance);
+	const uint8_t height = C8_GetDisplayHeight(instance);
+	const uint8_t x = instance->v[instance->instruction.x] % width;
+	const uint8_t y = instance->v[instance->instruction.y] % height;
+	uint16_t sprite = instance->i;
+
+	const bool isLargeSprite = instance->instruction.n == 0 && IS_PLATFORM(C8_PLATFORM_SUPER_CHIP);
+	const uint8_t rows = isLargeSprite ? 16 : instance->instruction.n;
 
 	instance->v[0xF] = 0;
+	uint64_t dirtyRows = 0;
 
-	for (uint8_t i = 0; i < instance->instruction.n; ++i)
+	for (uint8_t plane = 0; plane < instance->planeCount; ++plane)
 	{
-		const uint8_t spriteRow = instance->heap[sprite + i];
-		for (uint8_t j = 0; j < 8; ++j)
+		if (!IsPlaneSelected(instance, plane))
+			continue;
+
+		for (uint8_t i = 0; i < rows; ++i)
 		{
-			if (spriteRow << j & 0x80)
-			{
-				const uint8_t coordX = (x + j) % CHIP_8_DISPLAY_WIDTH;
-				const uint8_t coordY = (y + i) % CHIP_8_DISPLAY_HEIGHT;
-				const uint16_t index = coordY * 64 + coordX;
+			const uint8_t rowIndex = (y + i) % height;
+			uint64_t *row = C8_GetDisplayRow(instance, plane, rowIndex);
+			dirtyRows |= 1ull << rowIndex;
 
-				if (instance->framebuffer[index])
-					instance->v[0xF] = 1;
+			// Swap the row's old contribution to the display hash for its new one.
+			instance->displayHash ^= HashDisplayRow(instance, row);
 
-				instance->framebuffer[index] = !instance->framebuffer[index];
+			bool collided;
+			if (isLargeSprite)
+			{
+				const uint16_t spriteRow = C8_ReadHeap(instance, sprite + i * 2) << 8 | C8_ReadHeap(instance, sprite + i * 2 + 1);
+				collided = DrawSpriteRow(row, spriteRow, 16, x, width);
 			}
+			else
+			{
+				collided = DrawSpriteRow(row, C8_ReadHeap(instance, sprite + i), 8, x, width);
+			}
+
+			instance->displayHash ^= HashDisplayRow(instance, row);
+
+			if (collided)
+				instance->v[0xF] = 1;
 		}
+
+		sprite += isLargeSprite ? 32 : rows;
 	}
+
+	if (dirtyRows)
+		MarkRowsDirty(instance, dirtyRows);
 }
 
 // Skips the next instruction if the key corresponding to the value in the V(x) register is pressed.
 static void C8_EX9E(C8_Instance *instance)
 {
-	if (instance->keysPressed[instance->v[instance->instruction.x]])
+	if (instance->keysPressed[instance->v[instance->instruction.x] & 0xF])
 	{
-		instance->pc += INSTRUCTION_WIDTH;
+		SkipNextInstruction(instance);
 	}
 }
 
 // Skips the next instruction if the key corresponding to the value in the V(x) register is not pressed.
 static void C8_EXA1(C8_Instance *instance)
 {
-	if (!instance->keysPressed[instance->v[instance->instruction.x]])
+	if (!instance->keysPressed[instance->v[instance->instruction.x] & 0xF])
 	{
-		instance->pc += INSTRUCTION_WIDTH;
+		SkipNextInstruction(instance);
 	}
 }
 
@@ -268,13 +680,19 @@ static void C8_FX29(C8_Instance *instance)
 	instance->i = FONT_SPRITE_OFFSET + instance->v[instance->instruction.x] * FONT_SPRITE_WIDTH;
 }
 
+// Sets the index register to the memory address of the large font sprite for the value in the V(x) register.
+static void C8_FX30(C8_Instance *instance)
+{
+	instance->i = LARGE_FONT_SPRITE_OFFSET + (instance->v[instance->instruction.x] & 0xF) * LARGE_FONT_SPRITE_WIDTH;
+}
+
 // Loads the binary-coded decimal representation of the value in
 // the V(x) register into memory at the location in the index register.
 static void C8_FX33(C8_Instance *instance)
 {
-	instance->heap[instance->i] = instance->v[instance->instruction.x] / 100;
-	instance->heap[instance->i + 1] = instance->v[instance->instruction.x] / 10 % 10;
-	instance->heap[instance->i + 2] = instance->v[instance->instruction.x] % 10;
+	WriteHeap(instance, instance->i, instance->v[instance->instruction.x] / 100);
+	WriteHeap(instance, instance->i + 1, instance->v[instance->instruction.x] / 10 % 10);
+	WriteHeap(instance, instance->i + 2, instance->v[instance->instruction.x] % 10);
 }
 
 // Stores the values in registers V0 to V(x) in successive memory addresses, starting at the address in the index register.
@@ -285,14 +703,14 @@ static void C8_FX55(C8_Instance *instance)
 	{
 		for (uint8_t i = 0; i <= instance->instruction.x; ++i)
 		{
-			instance->heap[instance->i + i] = instance->v[i];
+			WriteHeap(instance, instance->i + i, instance->v[i]);
 		}
 	}
 	else
 	{
 		for (uint8_t i = 0; i <= instance->instruction.x; ++i)
 		{
-			instance->heap[instance->i++] = instance->v[i];
+			WriteHeap(instance, instance->i++, instance->v[i]);
 		}
 	}
 }
@@ -305,23 +723,211 @@ static void C8_FX65(C8_Instance *instance)
 	{
 		for (uint8_t i = 0; i <= instance->instruction.x; ++i)
 		{
-			instance->v[i] = instance->heap[instance->i + i];
+			instance->v[i] = C8_ReadHeap(instance, instance->i + i);
 		}
 	}
 	else
 	{
 		for (uint8_t i = 0; i <= instance->instruction.x; ++i)
 		{
-			instance->v[i] = instance->heap[instance->i++];
+			instance->v[i] = C8_ReadHeap(instance, instance->i++);
 		}
 	}
 }
 
+// Loads the 4-byte instruction's trailing 16-bit address into the index register.
+static void C8_F000(C8_Instance *instance)
+{
+	instance->i = C8_ReadHeap(instance, instance->pc) << 8 | C8_ReadHeap(instance, instance->pc + 1);
+	instance->pc += INSTRUCTION_WIDTH;
+}
+
+// Selects the bitplanes affected by drawing, clearing and scrolling, using (x) as a bitmask.
+static void C8_FN01(C8_Instance *instance)
+{
+	instance->selectedPlanes = instance->instruction.x & ((1 << instance->planeCount) - 1);
+}
+
+// Loads 16 bytes, starting at the address in the index register, into the audio pattern buffer.
+static void C8_F002(C8_Instance *instance)
+{
+	for (uint8_t i = 0; i < XO_CHIP_AUDIO_PATTERN_SIZE; ++i)
+		instance->audioPattern[i] = C8_ReadHeap(instance, instance->i + i);
+}
+
+// Sets the audio pitch to the value in the V(x) register.
+static void C8_FX3A(C8_Instance *instance)
+{
+	instance->pitch = instance->v[instance->instruction.x];
+}
+
+// Saves the values in registers V0 to V(x) to the flag registers.
+static void C8_FX75(C8_Instance *instance)
+{
+	memcpy(instance->flags, instance->v, instance->instruction.x + 1);
+}
+
+// Loads the values in the flag registers into registers V0 to V(x).
+static void C8_FX85(C8_Instance *instance)
+{
+	memcpy(instance->v, instance->flags, instance->instruction.x + 1);
+}
+
+// Executes the SUPER-CHIP instructions in the 0x0NNN range.
+static void C8_ExecuteSuperChip0NNN(C8_Instance *instance)
+{
+	if ((instance->instruction.nnn & 0xFF0) == 0x0C0)
+	{
+		C8_00CN(instance);
+		return;
+	}
+
+	if (IS_PLATFORM(C8_PLATFORM_XO_CHIP) && (instance->instruction.nnn & 0xFF0) == 0x0D0)
+	{
+		C8_00DN(instance);
+		return;
+	}
+
+	switch (instance->instruction.nnn)
+	{
+		case 0x0FB:
+			C8_00FB(instance);
+			break;
+		case 0x0FC:
+			C8_00FC(instance);
+			break;
+		case 0x0FD:
+			C8_00FD(instance);
+			break;
+		case 0x0FE:
+			C8_00FE(instance);
+			break;
+		case 0x0FF:
+			C8_00FF(instance);
+			break;
+		default:
+			break;
+	}
+}
+
+// Executes the SUPER-CHIP and XO-CHIP instructions in the 0xFXNN range.
+static void C8_ExecuteSuperChipFXNN(C8_Instance *instance)
+{
+	if (IS_PLATFORM(C8_PLATFORM_XO_CHIP))
+	{
+		switch (instance->instruction.nn)
+		{
+			case 0x00:
+				if (instance->instruction.x == 0)
+					C8_F000(instance);
+				return;
+			case 0x01:
+				C8_FN01(instance);
+				return;
+			case 0x02:
+				if (instance->instruction.x == 0)
+					C8_F002(instance);
+				return;
+			case 0x3A:
+				C8_FX3A(instance);
+				return;
+			default:
+				break;
+		}
+	}
+
+	switch (instance->instruction.nn)
+	{
+		case 0x30:
+			C8_FX30(instance);
+			break;
+		case 0x75:
+			C8_FX75(instance);
+			break;
+		case 0x85:
+			C8_FX85(instance);
+			break;
+		default:
+			break;
+	}
+}
+
+uint8_t C8_GetDisplayWidth(const C8_Instance *instance)
+{
+	return instance->isHighResolution ? SUPER_CHIP_DISPLAY_WIDTH : CHIP_8_DISPLAY_WIDTH;
+}
+
+uint8_t C8_GetDisplayHeight(const C8_Instance *instance)
+{
+	return instance->isHighResolution ? SUPER_CHIP_DISPLAY_HEIGHT : CHIP_8_DISPLAY_HEIGHT;
+}
+
+uint64_t *C8_GetDisplayRow(const C8_Instance *instance, const uint8_t plane, const uint8_t y)
+{
+	const uint8_t rowsPerPlane = instance->displayRowWords == 1 ? CHIP_8_DISPLAY_HEIGHT : SUPER_CHIP_DISPLAY_HEIGHT;
+	return instance->framebuffer + ((size_t)plane * rowsPerPlane + y) * instance->displayRowWords;
+}
+
+uint8_t C8_GetPixel(const C8_Instance *instance, const uint8_t x, const uint8_t y)
+{
+	uint8_t planes = 0;
+	for (uint8_t plane = 0; plane < instance->planeCount; ++plane)
+	{
+		const uint64_t word = C8_GetDisplayRow(instance, plane, y)[x / C8_PIXELS_PER_WORD];
+		planes |= (word >> (C8_PIXELS_PER_WORD - 1 - x % C8_PIXELS_PER_WORD) & 1) << plane;
+	}
+	return planes;
+}
+
+size_t C8_GetFramebufferSize(const C8_Instance *instance)
+{
+	const uint8_t rowsPerPlane = instance->displayRowWords == 1 ? CHIP_8_DISPLAY_HEIGHT : SUPER_CHIP_DISPLAY_HEIGHT;
+	return (size_t)instance->planeCount * rowsPerPlane * instance->displayRowWords * sizeof(uint64_t);
+}
+
+uint64_t C8_GetDirtyRows(const C8_Instance *instance, const uint32_t generation)
+{
+	// The generation only goes backwards if an earlier state was restored, so nothing is known to be unchanged.
+	if (generation > instance->displayGeneration)
+		return AllRows(instance);
+
+	uint64_t rows = 0;
+	for (uint8_t y = 0; y < C8_GetDisplayHeight(instance); ++y)
+	{
+		if (instance->rowGenerations[y] > generation)
+			rows |= 1ull << y;
+	}
+	return rows;
+}
+
+void C8_InvalidateDisplay(C8_Instance *instance, const uint32_t generation)
+{
+	if (generation > instance->displayGeneration)
+		instance->displayGeneration = generation;
+	MarkRowsDirty(instance, AllRows(instance));
+}
+
+float C8_GetAudioPlaybackRate(const C8_Instance *instance)
+{
+	return 4000.0f * powf(2.0f, (instance->pitch - XO_CHIP_DEFAULT_PITCH) / 48.0f);
+}
+
 void C8_FetchExecute(C8_Instance *instance)
 {
+	if (instance->status != C8_STATUS_RUNNING)
+		return;
+
+	if (instance->pc + INSTRUCTION_WIDTH > instance->heapSize)
+	{
+		instance->status = C8_STATUS_PC_OUT_OF_BOUNDS;
+		return;
+	}
+
+	++instance->cycleCount;
+
 	// Fetch
 	const uint16_t addr = instance->pc;
-	const uint16_t inst = (instance->heap[addr] << 8) | instance->heap[addr + 1]; // Combine two adjacent bytes into a 16-bit instruction
+	const uint16_t inst = (C8_ReadHeap(instance, addr) << 8) | C8_ReadHeap(instance, addr + 1); // Combine two adjacent bytes into a 16-bit instruction
 
 	// Decode
 	instance->instruction = (const C8_Instruction){
@@ -349,6 +955,8 @@ void C8_FetchExecute(C8_Instance *instance)
 					C8_00EE(instance);
 					break;
 				default:
+					if (IS_PLATFORM(C8_PLATFORM_SUPER_CHIP))
+						C8_ExecuteSuperChip0NNN(instance);
 					break;
 			}
 			break;
@@ -366,8 +974,15 @@ void C8_FetchExecute(C8_Instance *instance)
 			C8_4XNN(instance);
 			break;
 		case 0x5:
-			C8_5XY0(instance);
+		{
+			if (IS_PLATFORM(C8_PLATFORM_XO_CHIP) && instance->instruction.n == 0x2)
+				C8_5XY2(instance);
+			else if (IS_PLATFORM(C8_PLATFORM_XO_CHIP) && instance->instruction.n == 0x3)
+				C8_5XY3(instance);
+			else
+				C8_5XY0(instance);
 			break;
+		}
 		case 0x6:
 			C8_6XNN(instance);
 			break;
@@ -472,6 +1087,8 @@ void C8_FetchExecute(C8_Instance *instance)
 					C8_FX65(instance);
 					break;
 				default:
+					if (IS_PLATFORM(C8_PLATFORM_SUPER_CHIP))
+						C8_ExecuteSuperChipFXNN(instance);
 					break;
 			}
 			break;
@@ -481,6 +1098,35 @@ void C8_FetchExecute(C8_Instance *instance)
 	}
 }
 
+uint32_t C8_RunCycles(C8_Instance *instance, const uint32_t cycleCount)
+{
+	const uint16_t cyclesPerTimerTick = instance->config.cyclesPerTimerTick;
+	const uint64_t firstCycle = instance->cycleCount;
+	const uint64_t lastCycle = firstCycle + cycleCount;
+
+	while (instance->cycleCount < lastCycle && instance->status == C8_STATUS_RUNNING)
+	{
+		// Each batch ends at the next multiple of cyclesPerTimerTick or at the end of the run, whichever is sooner,
+		// so the timers are ticked at most once per batch instead of testing the cycle count after every cycle.
+		uint64_t batchEnd = lastCycle;
+		if (cyclesPerTimerTick)
+		{
+			const uint64_t nextTick = instance->cycleCount + cyclesPerTimerTick - instance->cycleCount % cyclesPerTimerTick;
+			batchEnd = nextTick < batchEnd ? nextTick : batchEnd;
+		}
+
+		while (instance->cycleCount < batchEnd && instance->status == C8_STATUS_RUNNING)
+			C8_FetchExecute(instance);
+
+		// Tick only if the batch executed up to a multiple. A fetch that halts execution doesn't advance the cycle
+		// count, so a batch cut short by a halt must not tick again for a multiple that was already ticked.
+		if (cyclesPerTimerTick && instance->cycleCount == batchEnd && batchEnd % cyclesPerTimerTick == 0)
+			C8_UpdateTimers(instance);
+	}
+
+	return (uint32_t)(instance->cycleCount - firstCycle);
+}
+
 void C8_UpdateTimers(C8_Instance *instance)
 {
 	if (instance->dt > 0)
@@ -503,7 +1149,95 @@ void C8_NotifyKeyEvent(C8_Instance *instance, const uint8_t key, const bool isKe
 	instance->pc += INSTRUCTION_WIDTH;
 }
 
-bool C8_LoadProgram(C8_Instance *instance, const char *filePath, char **error)
+// Describes the memory layout of each platform.
+typedef struct
+{
+	uint32_t heapSize;
+	uint8_t displayRowWords;
+	uint8_t planeCount;
+} PlatformLayout;
+
+static const PlatformLayout PLATFORM_LAYOUTS[] = {
+	[C8_PLATFORM_CHIP_8] = { CHIP_8_HEAP_SIZE, 1, 1 },
+	[C8_PLATFORM_SUPER_CHIP] = { CHIP_8_HEAP_SIZE, C8_DISPLAY_ROW_WORDS, 1 },
+	[C8_PLATFORM_XO_CHIP] = { XO_CHIP_HEAP_SIZE, C8_DISPLAY_ROW_WORDS, XO_CHIP_PLANE_COUNT }
+};
+
+static size_t GetFramebufferSize(const uint8_t displayRowWords, const uint8_t planeCount)
+{
+	const uint8_t displayHeight = displayRowWords == 1 ? CHIP_8_DISPLAY_HEIGHT : SUPER_CHIP_DISPLAY_HEIGHT;
+	return (size_t)planeCount * displayHeight * displayRowWords * sizeof(uint64_t);
+}
+
+static size_t GetPageTableSize(const uint32_t heapSize)
+{
+	return (heapSize >> C8_HEAP_PAGE_SHIFT) * sizeof(uint8_t *);
+}
+
+// Points the framebuffer and heap page table into a single block of memory, so that they can be copied and freed together.
+// The framebuffer is placed first to keep its words aligned.
+static void AssignMemory(C8_Instance *instance, uint8_t *memory, const uint32_t heapSize, const uint8_t displayRowWords, const uint8_t planeCount)
+{
+	instance->framebuffer = (uint64_t *)memory;
+	instance->heapPages = (uint8_t **)(memory + GetFramebufferSize(displayRowWords, planeCount));
+	instance->heapSize = heapSize;
+	instance->displayRowWords = displayRowWords;
+	instance->planeCount = planeCount;
+}
+
+static void FreeMemory(C8_Instance *instance)
+{
+	if (instance->heapPages)
+	{
+		for (uint32_t page = 0; page < instance->heapSize >> C8_HEAP_PAGE_SHIFT; ++page)
+		{
+			if (instance->heapPages[page])
+				ReleasePage(instance->heapPages[page]);
+		}
+	}
+
+	if (instance->ownsMemory)
+		free(instance->framebuffer);
+
+	instance->framebuffer = nullptr;
+	instance->heapPages = nullptr;
+	instance->ownsMemory = false;
+}
+
+// Allocates zeroed display memory and heap pages private to the instance.
+static bool AllocateMemory(C8_Instance *instance, const uint32_t heapSize, const uint8_t displayRowWords, const uint8_t planeCount)
+{
+	uint8_t *memory = calloc(1, GetFramebufferSize(displayRowWords, planeCount) + GetPageTableSize(heapSize));
+	if (!memory)
+		return false;
+
+	AssignMemory(instance, memory, heapSize, displayRowWords, planeCount);
+	instance->ownsMemory = true;
+	instance->heapHash = 0;
+	instance->displayHash = 0;
+
+	for (uint32_t page = 0; page < heapSize >> C8_HEAP_PAGE_SHIFT; ++page)
+	{
+		instance->heapPages[page] = AllocatePage();
+		if (!instance->heapPages[page])
+		{
+			FreeMemory(instance);
+			return false;
+		}
+		memset(instance->heapPages[page], 0, C8_HEAP_PAGE_SIZE);
+	}
+
+	return true;
+}
+
+// Writes a block of bytes to heap memory, starting at the specified address.
+static void WriteHeapBlock(C8_Instance *instance, const uint32_t address, const uint8_t *data, const size_t size)
+{
+	for (size_t i = 0; i < size; ++i)
+		WriteHeap(instance, address + i, data[i]);
+}
+
+bool C8_ReadProgram(const char *filePath, uint8_t *program, size_t *size, char **error)
 {
 	FILE *file = fopen(filePath, "rb");
 	if (!file)
@@ -512,45 +1246,223 @@ bool C8_LoadProgram(C8_Instance *instance, const char *filePath, char **error)
 		return false;
 	}
 
-	// 4KiB (heap size) - 512 bytes reserved = 3.5KiB (maximum program size)
-	constexpr uint16_t bufferSize = 4096 - 0x200;
-	uint8_t *buf = malloc(sizeof(uint8_t) * bufferSize);
-	if (!buf)
+	// Read one byte more than the largest program, so that a file which doesn't fit can be told apart from one that
+	// fills the heap exactly.
+	uint8_t excess;
+	*size = fread(program, 1, C8_MAX_PROGRAM_SIZE, file);
+	const bool isTooLarge = *size == C8_MAX_PROGRAM_SIZE && fread(&excess, 1, 1, file) == 1;
+	const bool hasFailed = ferror(file);
+	fclose(file);
+
+	if (hasFailed)
 	{
-		*error = "Failed to allocate memory.";
-		fclose(file);
+		*error = "Failed to read file at the specified path.";
 		return false;
 	}
 
-	int byte;
-	uint16_t count = 0;
-	while ((byte = fgetc(file)) != EOF)
+	if (isTooLarge)
 	{
-		if (count > bufferSize)
-		{
-			*error = "Failed to load program - exceeded 3.5KiB limit.";
-			fclose(file);
-			free(buf);
-			return false;
-		}
-		buf[count++] = byte;
+		*error = "Failed to load program - exceeded 63.5KiB limit.";
+		return false;
 	}
 
-	memcpy(&instance->heap[PROGRAM_OFFSET], buf, count);
+	return true;
+}
+
+bool C8_LoadProgramFromMemory(C8_Instance *instance, const uint8_t *program, const size_t size, char **error)
+{
+	// The program is copied into the heap, up to its end: 3.5KiB on CHIP-8 and SUPER-CHIP, or 63.5KiB on XO-CHIP.
+	const PlatformLayout layout = PLATFORM_LAYOUTS[instance->config.platform];
+	if (size > layout.heapSize - PROGRAM_OFFSET)
+	{
+		*error = layout.heapSize == XO_CHIP_HEAP_SIZE
+			? "Failed to load program - exceeded 63.5KiB limit."
+			: "Failed to load program - exceeded 3.5KiB limit.";
+		return false;
+	}
+
+	// Discard the memory of any previously loaded program, as the platform may have changed since.
+	FreeMemory(instance);
+
+	if (!AllocateMemory(instance, layout.heapSize, layout.displayRowWords, layout.planeCount))
+	{
+		*error = "Failed to allocate memory.";
+		return false;
+	}
 
-	memcpy(&instance->heap[FONT_SPRITE_OFFSET], DEFAULT_FONT, sizeof(DEFAULT_FONT));
+	WriteHeapBlock(instance, PROGRAM_OFFSET, program, size);
+	WriteHeapBlock(instance, FONT_SPRITE_OFFSET, DEFAULT_FONT, sizeof(DEFAULT_FONT));
+	WriteHeapBlock(instance, LARGE_FONT_SPRITE_OFFSET, LARGE_FONT, sizeof(LARGE_FONT));
 
 	instance->pc = PROGRAM_OFFSET;
+	instance->programSize = (uint16_t)size;
+	instance->cycleCount = 0;
+	instance->awaitKeyPressRegister = NOT_AWAITING;
+	instance->selectedPlanes = 1;
+	MarkRowsDirty(instance, AllRows(instance));
+	instance->pitch = XO_CHIP_DEFAULT_PITCH;
+	memcpy(instance->audioPattern, DEFAULT_AUDIO_PATTERN, sizeof(DEFAULT_AUDIO_PATTERN));
 
-	fclose(file);
-	free(buf);
+	C8_SeedRandom(instance, C8_DEFAULT_RANDOM_SEED);
+
+	return true;
+}
+
+bool C8_LoadProgram(C8_Instance *instance, const char *filePath, char **error)
+{
+	uint8_t *program = malloc(C8_MAX_PROGRAM_SIZE);
+	if (!program)
+	{
+		*error = "Failed to allocate memory.";
+		return false;
+	}
+
+	size_t size;
+	const bool isLoaded = C8_ReadProgram(filePath, program, &size, error) && C8_LoadProgramFromMemory(instance, program, size, error);
+	free(program);
+
+	return isLoaded;
+}
+
+uint64_t C8_GetStateHash(const C8_Instance *instance)
+{
+	// Gather the registers and other small state into a buffer, so that it can be folded in a word at a time.
+	// The buffer is padded to a whole number of words, with room for every field appended below.
+	uint8_t state[104] = { 0 };
+	size_t size = 0;
+
+#define APPEND_STATE(field) \
+	memcpy(state + size, &(field), sizeof(field)); \
+	size += sizeof(field)
+
+	APPEND_STATE(instance->v);
+	APPEND_STATE(instance->i);
+	APPEND_STATE(instance->pc);
+	APPEND_STATE(instance->sp);
+	APPEND_STATE(instance->stack);
+	APPEND_STATE(instance->dt);
+	APPEND_STATE(instance->st);
+	APPEND_STATE(instance->randomState);
+	APPEND_STATE(instance->status);
+	APPEND_STATE(instance->awaitKeyPressRegister);
+	APPEND_STATE(instance->isHighResolution);
+	APPEND_STATE(instance->selectedPlanes);
+	APPEND_STATE(instance->pitch);
+	APPEND_STATE(instance->audioPattern);
+	APPEND_STATE(instance->flags);
+
+#undef APPEND_STATE
+
+	uint64_t hash = instance->heapHash ^ MixHash(instance->displayHash);
+	for (size_t offset = 0; offset < size; offset += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, state + offset, sizeof(word));
+		hash = MixHash(hash ^ word);
+	}
+	return hash;
+}
+
+void C8_SeedRandom(C8_Instance *instance, const uint32_t seed)
+{
+	// xorshift32 never leaves the zero state, so substitute the default seed.
+	instance->randomState = seed ? seed : C8_DEFAULT_RANDOM_SEED;
+}
+
+size_t C8_GetMemorySize(const C8_Instance *instance)
+{
+	return instance->heapPages ? GetFramebufferSize(instance->displayRowWords, instance->planeCount) + GetPageTableSize(instance->heapSize) : 0;
+}
+
+// Shares the source's heap pages with the destination, whose page table has already been assigned.
+static void ShareMemory(C8_Instance *destination, const C8_Instance *source)
+{
+	memcpy(destination->framebuffer, source->framebuffer, C8_GetMemorySize(source));
+
+	for (uint32_t page = 0; page < source->heapSize >> C8_HEAP_PAGE_SHIFT; ++page)
+		RetainPage(source->heapPages[page]);
+}
+
+bool C8_CopyInstance(C8_Instance *destination, const C8_Instance *source)
+{
+	*destination = *source;
+	destination->framebuffer = nullptr;
+	destination->heapPages = nullptr;
+	destination->ownsMemory = false;
 
+	if (!source->heapPages)
+		return true;
+
+	uint8_t *memory = malloc(C8_GetMemorySize(source));
+	if (!memory)
+		return false;
+
+	AssignMemory(destination, memory, source->heapSize, source->displayRowWords, source->planeCount);
+	destination->ownsMemory = true;
+	ShareMemory(destination, source);
+	return true;
+}
+
+void C8_CopyInstanceInto(C8_Instance *destination, const C8_Instance *source, void *memory)
+{
+	*destination = *source;
+	destination->framebuffer = nullptr;
+	destination->heapPages = nullptr;
+	destination->ownsMemory = false;
+
+	if (!source->heapPages)
+		return;
+
+	AssignMemory(destination, memory, source->heapSize, source->displayRowWords, source->planeCount);
+	ShareMemory(destination, source);
+}
+
+bool C8_Fork(C8_Instance *destination, const C8_Instance *source)
+{
+	const bool canReuseMemory = destination->heapPages && source->heapPages
+		&& destination->heapSize == source->heapSize
+		&& destination->displayRowWords == source->displayRowWords
+		&& destination->planeCount == source->planeCount;
+
+	if (!canReuseMemory)
+	{
+		C8_Reset(destination);
+		return C8_CopyInstance(destination, source);
+	}
+
+	uint64_t *framebuffer = destination->framebuffer;
+	uint8_t **heapPages = destination->heapPages;
+	const bool ownsMemory = destination->ownsMemory;
+
+	// Forks of the same state share most of their pages, so reference counts are only touched where the tables differ.
+	for (uint32_t page = 0; page < source->heapSize >> C8_HEAP_PAGE_SHIFT; ++page)
+	{
+		if (heapPages[page] == source->heapPages[page])
+			continue;
+
+		RetainPage(source->heapPages[page]);
+		ReleasePage(heapPages[page]);
+		heapPages[page] = source->heapPages[page];
+	}
+
+	memcpy(framebuffer, source->framebuffer, C8_GetFramebufferSize(source));
+
+	*destination = *source;
+	destination->framebuffer = framebuffer;
+	destination->heapPages = heapPages;
+	destination->ownsMemory = ownsMemory;
 	return true;
 }
 
 void C8_Reset(C8_Instance *instance)
 {
+	FreeMemory(instance);
+
+	// The display generation keeps increasing, so that consumers which last saw a higher generation from the previous
+	// program don't mistake the next program's display for one they have already drawn.
 	const C8_Config prevConfig = instance->config;
+	const uint32_t prevDisplayGeneration = instance->displayGeneration;
 	*instance = (C8_Instance){ 0 };
 	instance->config = prevConfig;
+	instance->displayGeneration = prevDisplayGeneration;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef C8_VM_H
 #define C8_VM_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 // The horizontal resolution of the virtual display.
@@ -9,6 +10,45 @@
 // The vertical resolution of the virtual display.
 #define CHIP_8_DISPLAY_HEIGHT 32
 
+// The horizontal resolution of the virtual display in SUPER-CHIP high-resolution mode.
+#define SUPER_CHIP_DISPLAY_WIDTH 128
+
+// The vertical resolution of the virtual display in SUPER-CHIP high-resolution mode.
+#define SUPER_CHIP_DISPLAY_HEIGHT 64
+
+// The number of pixels packed into each word of the framebuffer.
+#define C8_PIXELS_PER_WORD 64
+
+// The maximum number of words in each row of the framebuffer.
+#define C8_DISPLAY_ROW_WORDS (SUPER_CHIP_DISPLAY_WIDTH / C8_PIXELS_PER_WORD)
+
+// The number of bitplanes composing the XO-CHIP display.
+#define XO_CHIP_PLANE_COUNT 2
+
+// The maximum number of words in the framebuffer, across all bitplanes.
+#define C8_FRAMEBUFFER_MAX_WORDS (XO_CHIP_PLANE_COUNT * SUPER_CHIP_DISPLAY_HEIGHT * C8_DISPLAY_ROW_WORDS)
+
+// The size (in bytes) of the virtual machine's heap memory.
+#define CHIP_8_HEAP_SIZE 4096
+
+// The size (in bytes) of the virtual machine's heap memory on XO-CHIP.
+#define XO_CHIP_HEAP_SIZE 65536
+
+// The size (in bytes) of each page of heap memory; heap pages are shared between copies of a virtual machine until written.
+#define C8_HEAP_PAGE_SIZE 256
+
+// The number of bits an address is shifted right by to find its heap page.
+#define C8_HEAP_PAGE_SHIFT 8
+
+// The size (in bytes) of the XO-CHIP audio pattern buffer.
+#define XO_CHIP_AUDIO_PATTERN_SIZE 16
+
+// The default XO-CHIP audio pitch, corresponding to a playback rate of 4000 bits per second.
+#define XO_CHIP_DEFAULT_PITCH 64
+
+// The depth of the function call stack.
+#define CHIP_8_STACK_DEPTH 16
+
 // The width (in bytes) of each instruction.
 #define INSTRUCTION_WIDTH sizeof(uint16_t)
 
@@ -18,18 +58,71 @@
 // The width (in pixels) of each font sprite.
 #define FONT_SPRITE_WIDTH 5
 
+// The location in virtual memory of the SUPER-CHIP large font.
+#define LARGE_FONT_SPRITE_OFFSET 0xA0
+
+// The width (in pixels) of each large font sprite.
+#define LARGE_FONT_SPRITE_WIDTH 10
+
+// The number of SUPER-CHIP flag registers that can be saved and loaded with 0xFX75 and 0xFX85.
+#define SUPER_CHIP_FLAG_REGISTER_COUNT 16
+
 // The location in virtual memory of the loaded program's first instruction.
 #define PROGRAM_OFFSET 0x200
 
+// The size (in bytes) of the largest program that can be loaded, which only fits in the XO-CHIP heap.
+#define C8_MAX_PROGRAM_SIZE (XO_CHIP_HEAP_SIZE - PROGRAM_OFFSET)
+
 // The maximum value that should be returned from the random number generator.
 #define CHIP_8_RAND_MAX 0xFF
 
 // The virtual machine is not currently awaiting any key presses.
 #define NOT_AWAITING (-1)
 
+// The seed used for the random number generator when a program is loaded.
+#define C8_DEFAULT_RANDOM_SEED 0x2F6B4C1Du
+
+// Describes whether the virtual machine can continue executing instructions.
+// Any status other than C8_STATUS_RUNNING halts execution until the virtual machine is reset.
+typedef enum
+{
+	C8_STATUS_RUNNING,
+
+	// A subroutine was called while the function call stack was full.
+	C8_STATUS_STACK_OVERFLOW,
+
+	// A subroutine returned while the function call stack was empty.
+	C8_STATUS_STACK_UNDERFLOW,
+
+	// The program counter no longer points to a whole instruction within heap memory.
+	C8_STATUS_PC_OUT_OF_BOUNDS,
+
+	// The program exited using the SUPER-CHIP 0x00FD instruction.
+	C8_STATUS_EXITED,
+
+	// Memory for a private copy of a shared heap page could not be allocated.
+	C8_STATUS_OUT_OF_MEMORY
+} C8_Status;
+
+// The interpreter whose instruction set the virtual machine implements.
+typedef enum
+{
+	// The original COSMAC VIP instruction set with a 64x32 display.
+	C8_PLATFORM_CHIP_8,
+
+	// Adds a 128x64 high-resolution mode, scrolling, 16x16 sprites, a large font and flag registers.
+	C8_PLATFORM_SUPER_CHIP,
+
+	// Extends SUPER-CHIP with 64KiB of memory, two bitplanes, register ranges and pattern-based audio.
+	C8_PLATFORM_XO_CHIP
+} C8_Platform;
+
 // Configures the behaviour of some CHIP-8 instructions to enable compatability with modern interpreters.
 typedef struct
 {
+	// The interpreter whose instruction set is implemented.
+	C8_Platform platform;
+
 	// If true (CHIP-48, SUPER-CHIP), shifts the value in the V(x) register in place and ignores the V(y) register.
 	// If false (COSMAC VIP), the value in the V(y) register is first copied into the V(x) register and then shifted.
 	// Affects the behaviour of both the 0x8XY6 (shift right) and 0x8XYE (shift left) instructions.
@@ -44,6 +137,11 @@ typedef struct
 	// If false, (COSMAC VIP), increments the index register when calculating the address offset.
 	// Affects the behaviour of both the 0xFX55 (store registers to memory) and 0xFX65 (store memory to registers) instructions.
 	bool useTemporaryIndex;
+
+	// If non-zero, C8_RunCycles updates the timers every time the cycle count reaches a multiple of this, so that they
+	// run in guest time and execution is independent of the host. Set it to a sixtieth of the clock rate to tick at 60Hz.
+	// If zero, the timers are left to the caller to update with C8_UpdateTimers.
+	uint16_t cyclesPerTimerTick;
 } C8_Config;
 
 // Represents a decoded CHIP-8 instruction.
@@ -63,6 +161,9 @@ typedef struct
 	// The virtual machine's configuration.
 	C8_Config config;
 
+	// Whether the virtual machine can continue executing instructions.
+	C8_Status status;
+
 	// The current instruction being executed by the virtual machine.
 	C8_Instruction instruction;
 
@@ -84,25 +185,117 @@ typedef struct
 	// Sound Timer
 	uint8_t st;
 
-	// Heap memory containing program instructions and data.
-	uint8_t heap[4096];
+	// Heap memory containing program instructions and data, sized for the configured platform when a program is loaded.
+	// The heap is split into pages of C8_HEAP_PAGE_SIZE bytes, which are reference-counted and shared with copies of
+	// the virtual machine until either side writes to them. Read it with C8_ReadHeap.
+	uint8_t **heapPages;
+
+	// The size (in bytes) of the heap; always a power of two.
+	uint32_t heapSize;
+
+	// If true, the display memory and heap page table were allocated by the virtual machine and are freed by C8_Reset;
+	// otherwise, they were provided by the caller through C8_CopyInstanceInto.
+	bool ownsMemory;
+
+	// The size (in bytes) of the loaded program, starting at PROGRAM_OFFSET.
+	uint16_t programSize;
 
 	// Function call stack.
-	uint16_t stack[16];
+	uint16_t stack[CHIP_8_STACK_DEPTH];
 
 	// If a key press is being awaited, this is the register it will be stored in.
 	int8_t awaitKeyPressRegister;
 
-	// The pixels composing the current frame.
-	bool framebuffer[CHIP_8_DISPLAY_WIDTH * CHIP_8_DISPLAY_HEIGHT];
+	// If true, the display is in SUPER-CHIP high-resolution (128x64) mode; otherwise, it is in low-resolution (64x32) mode.
+	bool isHighResolution;
+
+	// The pixels composing the current frame, sized for the configured platform when a program is loaded.
+	// Each bitplane is stored consecutively, as rows of displayRowWords words, with pixels packed from the most
+	// significant bit of each row's first word. In low-resolution mode, only the first word of the first 32 rows is used.
+	uint64_t *framebuffer;
+
+	// The number of words in each row of the framebuffer.
+	uint8_t displayRowWords;
+
+	// The number of bitplanes in the framebuffer.
+	uint8_t planeCount;
+
+	// A bitmask of the bitplanes affected by drawing, clearing and scrolling, selected with the XO-CHIP 0xFN01 instruction.
+	uint8_t selectedPlanes;
+
+	// Incremented whenever the display is changed, so that consumers can detect changed frames without comparing them.
+	// Kept across C8_Reset and program loads; it only goes backwards when an earlier state is restored with C8_Fork.
+	uint32_t displayGeneration;
+
+	// The display generation in which each row was last changed in any bitplane, read with C8_GetDirtyRows.
+	uint32_t rowGenerations[SUPER_CHIP_DISPLAY_HEIGHT];
+
+	// The XO-CHIP audio pattern buffer, played back one bit at a time while the sound timer is active.
+	uint8_t audioPattern[XO_CHIP_AUDIO_PATTERN_SIZE];
+
+	// The XO-CHIP audio pitch, which determines the playback rate of the audio pattern buffer.
+	uint8_t pitch;
+
+	// SUPER-CHIP flag registers, saved and loaded with 0xFX75 and 0xFX85.
+	uint8_t flags[SUPER_CHIP_FLAG_REGISTER_COUNT];
 
 	// The state of the virtual machine's hexadecimal (0-F) keypad.
 	bool keysPressed[16];
+
+	// The state of the random number generator used by the 0xCXNN instruction.
+	uint32_t randomState;
+
+	// The number of fetch-execute cycles performed since the program was loaded, which timestamps input when recording.
+	uint64_t cycleCount;
+
+	// Zobrist-style hashes of the heap and framebuffer: the XOR of a hash of each non-zero byte or word and its location,
+	// updated as memory is written so that C8_GetStateHash never has to scan it.
+	uint64_t heapHash;
+	uint64_t displayHash;
 } C8_Instance;
 
+// Returns the byte at the specified address in heap memory, wrapped to the bounds of the heap.
+static inline uint8_t C8_ReadHeap(const C8_Instance *instance, const uint32_t address)
+{
+	const uint32_t wrapped = address & (instance->heapSize - 1);
+	return instance->heapPages[wrapped >> C8_HEAP_PAGE_SHIFT][wrapped & (C8_HEAP_PAGE_SIZE - 1)];
+}
+
+// Returns the horizontal resolution of the virtual machine's display in its current mode.
+uint8_t C8_GetDisplayWidth(const C8_Instance *instance);
+
+// Returns the vertical resolution of the virtual machine's display in its current mode.
+uint8_t C8_GetDisplayHeight(const C8_Instance *instance);
+
+// Returns a pointer to the first word of the specified row of a bitplane in the framebuffer.
+uint64_t *C8_GetDisplayRow(const C8_Instance *instance, uint8_t plane, uint8_t y);
+
+// Returns a bitmask of the bitplanes in which the pixel at the specified co-ordinates is lit.
+uint8_t C8_GetPixel(const C8_Instance *instance, uint8_t x, uint8_t y);
+
+// Returns the size (in bytes) of the framebuffer across all bitplanes.
+size_t C8_GetFramebufferSize(const C8_Instance *instance);
+
+// Returns a bitmask of the display rows changed since the specified display generation, with bit (y) set for row (y).
+// Each consumer passes the generation it last caught up with, so any number of them can track changes independently.
+uint64_t C8_GetDirtyRows(const C8_Instance *instance, uint32_t generation);
+
+// Marks every display row as changed in a generation newer than both the instance's and [generation].
+// Call this after restoring the instance to a saved state, passing the generation it had before, as the saved state's
+// generation may already have been seen by consumers with different pixels.
+void C8_InvalidateDisplay(C8_Instance *instance, uint32_t generation);
+
+// Returns the rate (in bits per second) at which the audio pattern buffer is played back.
+float C8_GetAudioPlaybackRate(const C8_Instance *instance);
+
 // Performs a fetch-execute cycle for the provided virtual machine.
 void C8_FetchExecute(C8_Instance *vm);
 
+// Performs up to [cycleCount] fetch-execute cycles, stopping early if execution halts, and updates the timers in
+// between if the configuration sets cyclesPerTimerTick.
+// Returns the number of cycles performed.
+uint32_t C8_RunCycles(C8_Instance *instance, uint32_t cycleCount);
+
 // Updates the delay and sound timers.
 // This function should be called at a rate of 60Hz.
 void C8_UpdateTimers(C8_Instance *vm);
@@ -110,12 +303,55 @@ void C8_UpdateTimers(C8_Instance *vm);
 // Notifies the virtual machine that the specified key has been pressed or released.
 void C8_NotifyKeyEvent(C8_Instance *vm, uint8_t key, bool isKeyPressed);
 
-// Loads a CHIP-8 program and initialises the virtual machine.
+// Loads a CHIP-8 program and initialises the virtual machine,
+// allocating heap and display memory sized for the configured platform.
 // If this function returns false, error will be populated with a string describing the reason.
 // Returns true if the program was loaded successfully; otherwise, false.
 bool C8_LoadProgram(C8_Instance *instance, const char *filePath, char **error);
 
-// Resets the state of the virtual machine.
+// Reads a program of up to C8_MAX_PROGRAM_SIZE bytes into the provided buffer without loading it,
+// e.g. so that it can be analysed before choosing the platform to load it for.
+// If this function returns false, error will be populated with a string describing the reason.
+bool C8_ReadProgram(const char *filePath, uint8_t *program, size_t *size, char **error);
+
+// Loads a program that was already read into memory, as C8_LoadProgram does.
+// The instance is left unchanged if the program is too large for the configured platform.
+// If this function returns false, error will be populated with a string describing the reason.
+bool C8_LoadProgramFromMemory(C8_Instance *instance, const uint8_t *program, size_t size, char **error);
+
+// Returns a 64-bit hash of the guest state: registers, timers, stack, random number generator, heap and framebuffer,
+// along with the display mode and audio state. The keypad is excluded, as it is input rather than state.
+// Takes constant time regardless of heap size, so it can key a transposition table when searching over forked instances.
+uint64_t C8_GetStateHash(const C8_Instance *instance);
+
+// Seeds the virtual machine's random number generator.
+// Programs are seeded with C8_DEFAULT_RANDOM_SEED when loaded, so execution is reproducible unless reseeded.
+void C8_SeedRandom(C8_Instance *instance, uint32_t seed);
+
+// Copies the state of the source virtual machine into the destination, allocating its own display memory.
+// Heap pages are shared between the two and copied privately by whichever writes to one first, so copying is
+// independent of heap size. Instances sharing pages may run on different threads.
+// The destination must not hold any memory; reset it first if necessary.
+// Returns true if the copy was successful; otherwise, false.
+bool C8_CopyInstance(C8_Instance *destination, const C8_Instance *source);
+
+// Returns the size (in bytes) of the display memory and heap page table held by the virtual machine, as a single block.
+size_t C8_GetMemorySize(const C8_Instance *instance);
+
+// Copies the state of the source virtual machine into the destination, placing its display memory and heap page table
+// in [memory], which must be at least C8_GetMemorySize(source) bytes and aligned for uint64_t.
+// Heap pages are shared with the source as with C8_CopyInstance. The caller keeps ownership of [memory]; the destination never frees it.
+void C8_CopyInstanceInto(C8_Instance *destination, const C8_Instance *source, void *memory);
+
+// Makes the destination an exact copy of the source, including its random number generator, for search that
+// repeatedly rewinds a scratch instance to a saved state. If the destination already holds memory laid out like the
+// source's, e.g. from an earlier fork, it is reused: only the framebuffer is copied, and only heap pages the two don't
+// already share are swapped. Otherwise, the destination is reset and copied as with C8_CopyInstance.
+// Returns true if the fork was successful; otherwise, false.
+bool C8_Fork(C8_Instance *destination, const C8_Instance *source);
+
+// Resets the state of the virtual machine, releases its heap pages, and frees its display memory unless it was provided by the caller.
+// The configuration and display generation are kept, so a program loaded afterwards marks its display as changed.
 void C8_Reset(C8_Instance *vm);
 
 #endif // C8_VM_H
\ No newline at end of file